@@ -0,0 +1,385 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <algorithm>
+#include <sstream>
+#include "diamond_codec.hpp"
+#include "framed_codec.hpp"
+#include "tiled_codec.hpp"
+#include "round_pipeline.hpp"
+#include "batch_codec.hpp"
+#include "block_pipeline.hpp"
+
+// Throughput is reported in plaintext bytes for every benchmark.
+
+// Fixed-seed corpus so results are comparable between commits
+static string corpus(size_t length, unsigned seed = 42)
+{
+    mt19937 rng(seed);
+    string text(length, ' ');
+    for (char &c : text)
+        c = static_cast<char>('A' + rng() % 26);
+    return text;
+}
+
+// Longest message a grid of this size holds
+static int diamondSize(int gridSize) { return gridSize * gridSize / 2 + 1; }
+
+// Longest message that survives this many rounds within the maximum grid
+static int longestMessage(int rounds)
+{
+    int length = 1;
+    while (true)
+    {
+        try
+        {
+            diamond::encodedLength(length + 1, rounds);
+        }
+        catch (const CustomException &)
+        {
+            return length;
+        }
+        length++;
+    }
+}
+
+static void gridSizes(benchmark::internal::Benchmark *bench)
+{
+    for (int size = 3; size <= 99; size += 8)
+        bench->Arg(size);
+}
+
+// Encryption::encryption(): one round into a row-major grid
+static void BM_EncryptRound(benchmark::State &state)
+{
+    int size = static_cast<int>(state.range(0));
+    string msg = corpus(diamondSize(size));
+    string cells(size * size, ' ');
+
+    for (auto _ : state)
+    {
+        diamond::scatter(msg, size, &cells[0]);
+        benchmark::DoNotOptimize(cells.data());
+    }
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_EncryptRound)->Apply(gridSizes);
+
+// Decryption::decryption(): one round out of the column-major grid
+static void BM_DecryptRound(benchmark::State &state)
+{
+    int size = static_cast<int>(state.range(0));
+    string cipher = corpus(size * size);
+    string out;
+
+    for (auto _ : state)
+    {
+        out.clear();
+        diamond::gather(cipher.data(), size, false, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * diamondSize(size));
+}
+BENCHMARK(BM_DecryptRound)->Apply(gridSizes);
+
+// multi_encryption() as it runs in the menu: every round materialized
+static void BM_MultiEncryptChained(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    string msg = corpus(longestMessage(rounds));
+
+    for (auto _ : state)
+    {
+        string current = msg;
+        for (int round = 0; round < rounds; round++)
+        {
+            int size = diamond::gridSizeFor(static_cast<int>(current.length()));
+            string cells(size * size, ' ');
+            diamond::scatter(current, size, &cells[0]);
+            for (char &cell : cells)
+                if (cell == ' ')
+                    cell = diamond::fillerChar(); // Grid::printGrid() fills the rest
+            current.swap(cells);
+        }
+        benchmark::DoNotOptimize(current.data());
+    }
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_MultiEncryptChained)->DenseRange(1, 8);
+
+// multi_encryption() through the composed round map
+static void BM_MultiEncrypt(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    string msg = corpus(longestMessage(rounds));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(diamond::encode(msg, rounds));
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_MultiEncrypt)->DenseRange(1, 8);
+
+// multi_decryption() through the composed round map
+static void BM_MultiDecrypt(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    string msg = corpus(longestMessage(rounds));
+    string cipher = diamond::encode(msg, rounds);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(diamond::decode(cipher, rounds, false));
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_MultiDecrypt)->DenseRange(1, 8);
+
+// Same as BM_MultiDecrypt but into a reused buffer: no allocation per call
+static void BM_MultiDecryptInto(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    string msg = corpus(longestMessage(rounds));
+    string cipher = diamond::encode(msg, rounds);
+    string out;
+
+    for (auto _ : state)
+    {
+        diamond::decode(cipher, rounds, out, false);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_MultiDecryptInto)->DenseRange(1, 8);
+
+// Framed decode: exact length from the header, no '.' scan
+static void BM_Unframe(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    string msg = corpus(longestMessage(rounds));
+    string framed = diamond::frame(msg, rounds);
+    string out(msg.length(), ' ');
+
+    for (auto _ : state)
+    {
+        diamond::unframeInto(framed, &out[0], out.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_Unframe)->DenseRange(1, 8);
+
+// 16-character header of a multi-round ciphertext without decoding the rest
+static void BM_DecodePrefix(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    string cipher = diamond::encode(corpus(longestMessage(rounds)), rounds);
+    char header[16];
+
+    for (auto _ : state)
+    {
+        diamond::decodeRange(cipher, rounds, 0, sizeof(header), header);
+        benchmark::DoNotOptimize(header);
+    }
+    state.SetBytesProcessed(state.iterations() * sizeof(header));
+}
+BENCHMARK(BM_DecodePrefix)->DenseRange(1, 4);
+
+// Grid::autoGridSize()
+static void BM_AutoGridSize(benchmark::State &state)
+{
+    int length = static_cast<int>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(diamond::gridSizeFor(length));
+}
+BENCHMARK(BM_AutoGridSize)->Arg(5)->Arg(500)->Arg(4901);
+
+// Message::addMessage() normalization
+static void BM_Normalize(benchmark::State &state)
+{
+    string text = corpus(static_cast<size_t>(state.range(0)));
+    for (size_t i = 7; i < text.length(); i += 8)
+        text[i] = ' ';
+    transform(text.begin(), text.begin() + text.length() / 2, text.begin(),
+              [](unsigned char c)
+              { return static_cast<char>(tolower(c)); });
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(diamond::normalize(text));
+    state.SetBytesProcessed(state.iterations() * text.length());
+}
+BENCHMARK(BM_Normalize)->Arg(64)->Arg(4096);
+
+// Beyond a single grid: block streaming of a 1 MB message
+static void BM_StreamEncode(benchmark::State &state)
+{
+    diamond::StreamOptions options;
+    options.block_size = static_cast<int>(state.range(0));
+    options.rounds = static_cast<int>(state.range(1));
+    string text = corpus(1 << 20);
+
+    for (auto _ : state)
+    {
+        istringstream in(text);
+        ostringstream out;
+        diamond::BlockPipeline(options).encode(in, out);
+        benchmark::DoNotOptimize(out.str().data());
+    }
+    state.SetBytesProcessed(state.iterations() * text.length());
+}
+BENCHMARK(BM_StreamEncode)->Args({256, 1})->Args({4096, 1})->Args({256, 2});
+
+static void BM_StreamDecode(benchmark::State &state)
+{
+    diamond::StreamOptions options;
+    options.block_size = static_cast<int>(state.range(0));
+    options.rounds = static_cast<int>(state.range(1));
+
+    string text = corpus(1 << 20);
+    istringstream plain(text);
+    ostringstream encoded;
+    diamond::BlockPipeline(options).encode(plain, encoded);
+    string cipher = encoded.str();
+
+    for (auto _ : state)
+    {
+        istringstream in(cipher);
+        ostringstream out;
+        diamond::BlockPipeline(options).decode(in, out);
+        benchmark::DoNotOptimize(out.str().data());
+    }
+    state.SetBytesProcessed(state.iterations() * text.length());
+}
+BENCHMARK(BM_StreamDecode)->Args({256, 1})->Args({4096, 1})->Args({256, 2});
+
+// Many medium messages, 4 or 6 rounds each: whole messages per worker, then rounds per stage
+static vector<string> mediumBatch()
+{
+    vector<string> messages;
+    for (int i = 0; i < 256; i++)
+        messages.push_back(corpus(40 + i % 20, i));
+    return messages;
+}
+
+static void BM_BatchPerMessage(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    vector<string> messages = mediumBatch(), results;
+    diamond::ParallelCodec codec(4);
+
+    for (auto _ : state)
+    {
+        codec.encodeBlocks(messages, rounds, results);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * messages.size());
+}
+BENCHMARK(BM_BatchPerMessage)->Arg(4)->Arg(6)->UseRealTime();
+
+static void BM_BatchRoundPipeline(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    vector<string> messages = mediumBatch(), results;
+    diamond::RoundPipeline pipeline(rounds, 4);
+
+    for (auto _ : state)
+    {
+        pipeline.encode(messages, results);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * messages.size());
+}
+BENCHMARK(BM_BatchRoundPipeline)->Arg(4)->Arg(6)->UseRealTime();
+
+// A million short records of similar length
+static vector<string> recordBatch()
+{
+    string text = corpus(64);
+    vector<string> records;
+    for (int i = 0; i < 1000000; i++)
+        records.push_back(text.substr(0, 24 + i % 16));
+    return records;
+}
+
+static void BM_RecordsPerMessage(benchmark::State &state)
+{
+    int rounds = static_cast<int>(state.range(0));
+    vector<string> records = recordBatch(), results(records.size());
+
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < records.size(); i++)
+            diamond::encode(records[i], rounds, results[i]);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_RecordsPerMessage)->Arg(1)->Arg(3)->Unit(benchmark::kMillisecond);
+
+static void BM_RecordsBucketed(benchmark::State &state)
+{
+    vector<string> records = recordBatch(), results;
+    diamond::BatchCodec batch(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        batch.encode(records, results);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_RecordsBucketed)->Arg(1)->Arg(3)->Unit(benchmark::kMillisecond);
+
+static void largeGridSizes(benchmark::internal::Benchmark *bench)
+{
+    for (int size : {99, 255, 1023, 4095})
+        bench->Arg(size);
+}
+
+// Untiled reference: gather in diamond order through an index table, as the table codec does
+static void BM_LargeGatherRingOrder(benchmark::State &state)
+{
+    int size = static_cast<int>(state.range(0));
+    vector<int> cells(diamondSize(size));
+    for (int k = 0; k < diamondSize(size); k++)
+        cells[k] = diamond::diamondCell(size, k);
+    string cipher = corpus(static_cast<size_t>(size) * size);
+    string out(diamondSize(size), ' ');
+
+    for (auto _ : state)
+    {
+        for (size_t k = 0; k < cells.size(); k++)
+            out[k] = cipher[cells[k]];
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * diamondSize(size));
+}
+BENCHMARK(BM_LargeGatherRingOrder)->Apply(largeGridSizes);
+
+static void BM_TiledGather(benchmark::State &state)
+{
+    int size = static_cast<int>(state.range(0));
+    string cipher = corpus(static_cast<size_t>(size) * size);
+    string out(diamondSize(size), ' ');
+
+    for (auto _ : state)
+    {
+        diamond::tiledGather(cipher.data(), size, &out[0]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * diamondSize(size));
+}
+BENCHMARK(BM_TiledGather)->Apply(largeGridSizes);
+
+static void BM_TiledScatter(benchmark::State &state)
+{
+    int size = static_cast<int>(state.range(0));
+    string msg = corpus(diamondSize(size));
+    string cells(static_cast<size_t>(size) * size, ' ');
+
+    for (auto _ : state)
+    {
+        diamond::tiledScatter(msg, size, &cells[0]);
+        benchmark::DoNotOptimize(cells.data());
+    }
+    state.SetBytesProcessed(state.iterations() * msg.length());
+}
+BENCHMARK(BM_TiledScatter)->Apply(largeGridSizes);
+
+BENCHMARK_MAIN();
@@ -4,59 +4,23 @@
 #include <vector>
 #include <iomanip>
 #include <sstream>
-#include <thread> // for this_thread::sleep_for
-#include <chrono> // for chrono::seconds
+#include <thread>
+#include <chrono>
+#include <fstream>
 #include <algorithm>
 #include <cmath>
 #include "menu_printer.hpp"
+#include "menu_session.hpp"
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+#include "block_stream.hpp"
+#include "block_pipeline.hpp"
+#include "mapped_file.hpp"
+#include "codec_daemon.hpp"
+#include <csignal>
 
 using namespace std;
 
-class CustomException : public exception
-{
-public:
-    // identify kinds or error
-    enum class Type
-    {
-        Generic,
-        InvalidGridSize,
-        InvalidInput
-    };
-
-private:
-    string error_message;
-    Type type_;
-
-public:
-    // Constructor for generic message
-    explicit CustomException(const string &message)
-        : error_message(message), type_(Type::Generic) {}
-
-    // Constructor for InvalidGridSizeException
-    explicit CustomException(int gridSize)
-        : type_(Type::InvalidGridSize)
-    {
-        error_message = "Invalid grid size: " + to_string(gridSize);
-    }
-
-    // Constructor for InvalidInputException
-    explicit CustomException(const string &message, bool isInputError)
-        : type_(Type::InvalidInput)
-    {
-        error_message = "Invalid input: " + message;
-    }
-
-    virtual const char *what() const noexcept override
-    {
-        return error_message.c_str();
-    }
-
-    Type getType() const
-    {
-        return type_;
-    }
-};
-
 // Struct to manage menu context and user input
 struct MenuContext
 {
@@ -76,7 +40,7 @@ struct MenuContext
     void errorHandling()
     {
         cout << "\nEnter an option (number): ";
-        getline(cin, inputBuffer);
+        readMenuLine(inputBuffer);
 
         // Trim leading/trailing spaces
         inputBuffer.erase(0, inputBuffer.find_first_not_of(" \t\n\r"));
@@ -110,7 +74,7 @@ struct MenuContext
 void number_error(int *buffer)
 {
     string line;
-    getline(cin, line);
+    readMenuLine(line);
 
     if (line.empty())
     {
@@ -154,39 +118,22 @@ public:
             try
             {
                 cout << "Enter a message to encrypt: ";
-                getline(cin, messageBuffer);
+                readMenuLine(messageBuffer);
 
-                // Remove spaces
-                messageBuffer.erase(remove(messageBuffer.begin(), messageBuffer.end(), ' '), messageBuffer.end());
-
-                if (!isValidMessage(messageBuffer))
-                    throw CustomException("Input must be non-empty and contain only letters (A-Z or a-z).", true);
-
-                // Convert to uppercase
-                transform(messageBuffer.begin(), messageBuffer.end(), messageBuffer.begin(),
-                          [](unsigned char c)
-                          { return toupper(c); });
-
-                message = messageBuffer;
+                // Remove spaces, validate and convert to uppercase
+                message = diamond::normalize(messageBuffer);
                 break;
             }
             catch (const CustomException &e)
             {
                 cout << "Error: " << e.what() << endl;
+                SessionReport::error(e.what());
                 cout << "Please try again." << endl;
             }
         }
     }
 
-    bool isValidMessage(const string &input) const
-    {
-        if (input.empty())
-            return false;
-        for (char c : input)
-            if (!(isalpha(static_cast<unsigned char>(c)) || c == '.'))
-                return false;
-        return true;
-    }
+    bool isValidMessage(const string &input) const { return diamond::isValidMessage(input); }
 
     // Getters and setters
     int getMessageLength() const { return static_cast<int>(message.length()); }
@@ -196,12 +143,16 @@ public:
     const string &getTempMessage() const { return temp_message; }
     int getMessageIndex() const { return message_index; }
 
-    void appendEncryptedMessage(const string &temp) { encrypted_message += temp; }
-    void appendEncryptedMessage(char &temp) { encrypted_message += temp; }
-    void appendDecryptedMessage(char &temp) { decrypted_message += temp; }
+    // Buffers are cleared rather than released, so repeated rounds reuse their capacity
+    string &getDecryptedBuffer() { return decrypted_message; }
+    void appendEncryptedMessage(string_view temp) { encrypted_message.append(temp.data(), temp.size()); }
+    void appendDecryptedMessage(string_view temp) { decrypted_message.append(temp.data(), temp.size()); }
     void setTempMessage(const string &temp) { temp_message = temp; }
     void setUserMessage(const string &temp) { temp_message = temp; }
 
+    // Next round's input is the first length decrypted characters, copied into existing capacity
+    void promoteDecrypted(size_t length) { temp_message.assign(decrypted_message, 0, length); }
+
     void incrementIndex() { ++message_index; }
     void resetIndex() { message_index = 0; }
     void resetEncrypted() { encrypted_message.clear(); }
@@ -211,13 +162,36 @@ public:
 
 class Grid
 {
+public:
+    // storage order of the flat cell buffer
+    enum class Layout
+    {
+        RowMajor,
+        ColumnMajor
+    };
+
 private:
     int grid_size;
-    vector<vector<char>> grid;
+    vector<char> cells; // one contiguous size * size buffer
+    Layout layout;
     Message &message; // Reference to associated Message
 
 public:
-    explicit Grid(Message &msg) : message(msg), grid_size(3), grid(3, vector<char>(3, ' ')) {}
+    explicit Grid(Message &msg) : grid_size(3), cells(9, ' '), layout(Layout::RowMajor), message(msg) {}
+
+    // Resize and clear the buffer in one allocation
+    void reset(int size, char fill, Layout order = Layout::RowMajor)
+    {
+        grid_size = size;
+        layout = order;
+        cells.assign(static_cast<size_t>(size) * size, fill);
+    }
+
+    // 2D view over the flat buffer
+    char &at(int row, int col)
+    {
+        return layout == Layout::RowMajor ? cells[row * grid_size + col] : cells[col * grid_size + row];
+    }
 
     void addGrid()
     {
@@ -240,13 +214,13 @@ public:
                 if (grid_size_buffer % 2 == 0)
                     throw CustomException(grid_size_buffer);
 
-                grid_size = grid_size_buffer;
-                grid.assign(grid_size, vector<char>(grid_size, ' '));
+                reset(grid_size_buffer, ' ');
                 break;
             }
             catch (const CustomException &e)
             {
                 cout << "Error: " << e.what() << endl;
+                SessionReport::error(e.what());
                 cout << "Please enter a valid odd grid size large enough for the message." << endl;
             }
         }
@@ -258,17 +232,21 @@ public:
         if (!message.getEncryptedMessage().empty())
             length = static_cast<int>(message.getEncryptedMessage().length());
 
-        grid_size = 3;
-        const int max_grid_size = 99;
+        reset(diamond::gridSizeFor(length), ' ');
+    }
 
-        while ((grid_size * grid_size / 2 + 1) < length)
+    // Fill every empty cell with a random letter, one padding run at a time
+    void fillPadding()
+    {
+        diamond::FillerRng &rng = diamond::FillerRng::local();
+        auto begin = cells.begin();
+        while ((begin = find(begin, cells.end(), ' ')) != cells.end())
         {
-            grid_size += 2;
-            if (grid_size > max_grid_size)
-                throw CustomException("Message too long for maximum grid size", true);
+            auto end = find_if(begin, cells.end(), [](char c)
+                               { return c != ' '; });
+            rng.fillLetters(&*begin, end - begin);
+            begin = end;
         }
-
-        grid.assign(grid_size, vector<char>(grid_size, ' '));
     }
 
     // Print the grid (column-major order)
@@ -277,34 +255,30 @@ public:
         if (message.getMessage().empty())
         {
             cout << "Please enter a message first" << endl;
-            this_thread::sleep_for(chrono::seconds(1));
+            Pacing::pause(1);
             return;
         }
 
         if (message.getMessage().length() > grid_size * grid_size / 2 + 1)
         {
             cout << "Error: grid cannot contain message" << endl;
-            this_thread::sleep_for(chrono::seconds(1));
+            Pacing::pause(1);
             return;
         }
 
-        srand(static_cast<unsigned int>(time(nullptr)));
-        for (size_t i = 0; i < grid_size; i++)
+        for (int i = 0; i < grid_size; i++)
         {
-            for (size_t j = 0; j < grid_size; j++)
+            for (int j = 0; j < grid_size; j++)
             {
-                if (grid[j][i] == ' ')
-                {
-                    grid[j][i] = 'A' + rand() % 26;
-                }
-                cout << grid[j][i] << ' ';
+                cout << at(j, i) << ' ';
             }
             cout << endl;
         }
     }
     // Getters and setters
     int getGridSize() const { return grid_size; }
-    vector<vector<char>> &getGrid() { return grid; }
+    vector<char> &getCells() { return cells; }
+    Layout getLayout() const { return layout; }
     int getDiamondSize() const { return grid_size * grid_size / 2 + 1; }
 
     void resetGridSize() { grid_size = 3; }
@@ -331,7 +305,8 @@ public:
 class Encryption : public Processor
 {
 private:
-    int encrypt_round;
+    int encrypt_round = 1; // until the user enters a round number
+    string output; // reused by composed_encryption
 
 public:
     Encryption(Message &msg, Grid &grd) : Processor(msg, grd) {}
@@ -344,56 +319,22 @@ public:
         encrypt_round = buffer;
     }
 
-    // final encrypted message
-    void secret_message(vector<vector<char>> &Grid)
+    // final encrypted message: a linear sweep over the row-major cells
+    void secret_message(const vector<char> &cells)
     {
-        string temp;
-        for (int col = 0; col < grid.getGridSize(); col++)
-        {
-            for (int row = 0; row < grid.getGridSize(); row++)
-            {
-                temp += Grid[col][row];
-            }
-        }
-        message.appendEncryptedMessage(temp);
+        message.appendEncryptedMessage(string_view(cells.data(), cells.size()));
     }
 
     void encryption()
     {
         int size = grid.getGridSize();
-        int tip = size / 2;
-        int length = message.getEncryptedMessage().length() > 0 ? message.getEncryptedMessage().length() : message.getMessageLength();
         const string &current_message = message.getEncryptedMessage().length() > 0 ? message.getEncryptedMessage() : message.getMessage();
-
-        int max_chars_half = 1 + tip * 2;
-        int upper_offset = 0, lower_offset = tip - 1;
-        int counter = 0;
         int msg_index = message.getMessageIndex(); // current int dex of the message
 
-        while (msg_index < length)
-        {
-            // Fill upper half
-            for (int i = counter; i < max_chars_half && msg_index < length; i++, msg_index++)
-            {
-                int row = i;
-                int col = (i <= tip) ? (tip - upper_offset++) : (tip - lower_offset--);
-                grid.getGrid()[row][col] = current_message[msg_index];
-            }
-
-            lower_offset = 1;
-            // Fill lower half
-            for (int j = size - 2 - counter; j > counter && msg_index < length; j--, msg_index++)
-            {
-                int col = tip + lower_offset;
-                grid.getGrid()[j][col] = current_message[msg_index];
-                lower_offset = (j > tip) ? lower_offset + 1 : lower_offset - 1;
-            }
+        if (grid.getLayout() != Grid::Layout::RowMajor || static_cast<int>(grid.getCells().size()) != size * size)
+            grid.reset(size, ' ');
 
-            max_chars_half--;
-            upper_offset = 0;
-            counter++;
-            lower_offset = tip - counter - 1;
-        }
+        diamond::scatter(string_view(current_message).substr(msg_index), size, grid.getCells().data());
         resetIndex(); // resetting the index position for the new round
     }
 
@@ -403,29 +344,48 @@ public:
         {
             grid.autoGridSize();
             encryption();
+            grid.fillPadding();
             grid.printGrid();
             message.resetEncrypted();
-            secret_message(grid.getGrid());
+            secret_message(grid.getCells());
             cout << "Corresponding encrypted message:\n"
                  << message.getEncryptedMessage() << endl;
-            this_thread::sleep_for(chrono::seconds(5));
+            SessionReport::result("encrypt_round", message.getEncryptedMessage(), i + 1, encrypt_round, grid.getGridSize());
+            Pacing::pause(5);
         }
         message.resetEncrypted();
     }
 
+    // All rounds in one pass through the composed round map (no per-round grids)
+    void composed_encryption()
+    {
+        const string &current_message = message.getEncryptedMessage().length() > 0 ? message.getEncryptedMessage() : message.getMessage();
+        diamond::encode(current_message, encrypt_round, output);
+
+        message.resetEncrypted();
+        message.appendEncryptedMessage(output);
+        cout << "Encrypted message after " << encrypt_round << " rounds:\n"
+             << message.getEncryptedMessage() << endl;
+        SessionReport::result("encrypt", message.getEncryptedMessage(), 0, encrypt_round);
+        Pacing::pause(5);
+        message.resetEncrypted();
+    }
+
     void encryptAndDisplay()
     {
         if (getClassGrid().getGridSize() <= 0)
             throw CustomException("Grid size must be greater than 0. Please set the grid size first.", true);
 
         encryption();
+        getClassGrid().fillPadding();
         getClassGrid().printGrid();
-        secret_message(getClassGrid().getGrid());
+        secret_message(getClassGrid().getCells());
         cout << "Encrypted message (5 second display): " << getMessage().getEncryptedMessage() << endl;
+        SessionReport::result("encrypt", getMessage().getEncryptedMessage(), 0, 1, getClassGrid().getGridSize());
 
         getMessage().resetEncrypted();
 
-        this_thread::sleep_for(chrono::seconds(5));
+        Pacing::pause(5);
     }
 
     // getter function
@@ -435,20 +395,15 @@ public:
 class Decryption : public Processor
 {
 private:
-    int decrypt_round;
+    int decrypt_round = 1;
 
 public:
     Decryption(Message &msg, Grid &grd) : Processor(msg, grd) {}
 
     void autoGridSize()
     {
-        int root = static_cast<int>(sqrt(message.getTempMessage().length()));
-        if (root % 2 == 0)
-            grid.setGridSize(root - 1);
-        else
-            grid.setGridSize(root);
-
-        grid.getGrid().assign(grid.getGridSize(), vector<char>(grid.getGridSize(), ' '));
+        int size = diamond::decodeGridSize(static_cast<int>(message.getTempMessage().length()));
+        grid.reset(size, ' ', Grid::Layout::ColumnMajor);
     }
 
     void addDecryptRound()
@@ -471,16 +426,10 @@ public:
             try
             {
                 cout << "Enter a message to decrypt: ";
-                getline(cin, messageBuffer);
+                readMenuLine(messageBuffer);
 
-                // Remove spaces
-                messageBuffer.erase(remove(messageBuffer.begin(), messageBuffer.end(), ' '), messageBuffer.end());
-
-                // Validate message content
-                if (!message.isValidMessage(messageBuffer))
-                {
-                    throw CustomException("Input must be non-empty and contain only letters (A-Z or a-z).", true);
-                }
+                // Remove spaces, validate and convert to uppercase
+                messageBuffer = diamond::normalize(messageBuffer);
 
                 // Check if message length is a perfect square
                 int root = static_cast<int>(sqrt(messageBuffer.length()));
@@ -489,16 +438,12 @@ public:
                     throw CustomException("The message must be a perfect square grid", true);
                 }
 
-                // Convert to uppercase
-                transform(messageBuffer.begin(), messageBuffer.end(), messageBuffer.begin(),
-                          [](unsigned char c)
-                          { return toupper(c); });
-
                 break; // valid input, exit loop
             }
             catch (const CustomException &e)
             {
                 cout << "Error: " << e.what() << endl;
+                SessionReport::error(e.what());
                 cout << "Please try again." << endl;
             }
         }
@@ -521,7 +466,7 @@ public:
         {
             for (int col = 0; col < gridSize; ++col)
             {
-                cout << grid.getGrid()[row][col] << ' ';
+                cout << grid.at(row, col) << ' ';
             }
             cout << endl;
         }
@@ -531,65 +476,17 @@ public:
     {
         int gridSize = grid.getGridSize();
         int messageLength = static_cast<int>(message.getTempMessage().length());
-        int index = 0;
 
-        grid.getGrid().assign(gridSize, vector<char>(gridSize, '.'));
-
-        for (int row = 0; row < gridSize; ++row)
-        {
-            for (int col = 0; col < gridSize; ++col)
-            {
-                if (index < messageLength)
-                {
-                    grid.getGrid()[col][row] = message.getTempMessage()[index++];
-                }
-            }
-        }
+        // The grid is filled transposed, so a column-major view makes it a straight copy
+        grid.reset(gridSize, '.', Grid::Layout::ColumnMajor);
+        int count = min(messageLength, gridSize * gridSize);
+        copy(message.getTempMessage().begin(), message.getTempMessage().begin() + count, grid.getCells().begin());
     }
 
     void decryption(bool stopAtDot = true)
     {
-        int tip = grid.getGridSize() / 2;
-        int upper_offset = 0, lower_offset = tip - 1;
-        int max_chars_half = 1 + tip * 2;
-        int counter = 0;
-        int chars_added = 0;
-        bool foundDot = false;
-        char c;
-
-        while (!foundDot && chars_added < grid.getDiamondSize())
-        {
-            for (int i = counter; i < max_chars_half; i++, chars_added++)
-            {
-                c = grid.getGrid()[tip - (i <= tip ? upper_offset++ : lower_offset--)][i];
-                if (stopAtDot && c == '.')
-                {
-                    message.appendDecryptedMessage(c);
-                    foundDot = true;
-                    break;
-                }
-                message.appendDecryptedMessage(c);
-            }
-            if (foundDot)
-                break;
-
-            lower_offset = 1;
-            for (int j = grid.getGridSize() - 2 - counter; j > counter; j--, chars_added++)
-            {
-                c = grid.getGrid()[tip + lower_offset][j]; // Fixed here
-                lower_offset += (j > tip) ? 1 : -1;
-                if (stopAtDot && c == '.')
-                {
-                    foundDot = true;
-                    break;
-                }
-                message.appendDecryptedMessage(c);
-            }
-            max_chars_half--;
-            upper_offset = 0;
-            counter++;
-            lower_offset = tip - counter - 1;
-        }
+        // column-major cells line up with the diamond table
+        diamond::gather(grid.getCells().data(), grid.getGridSize(), stopAtDot, message.getDecryptedBuffer());
     }
 
     void multi_decryption()
@@ -604,27 +501,31 @@ public:
             decryption(stopAtDot);
 
             cout << "Corresponding decoded message: " << message.getDecryptedMessage() << endl;
+            SessionReport::result("decrypt_round", message.getDecryptedMessage(), i + 1, decrypt_round, grid.getGridSize());
             truncate_decrypt_message();
             message.resetDecrypted();
 
-            this_thread::sleep_for(chrono::seconds(5));
+            Pacing::pause(5);
         }
         message.resetMessageDecrypted();
     }
 
+    // All rounds in one pass through the composed round map (no per-round grids)
+    void composed_decryption()
+    {
+        diamond::decode(message.getTempMessage(), decrypt_round, message.getDecryptedBuffer());
+        cout << "Decoded message after " << decrypt_round << " rounds: " << message.getDecryptedMessage() << endl;
+        SessionReport::result("decrypt", message.getDecryptedMessage(), 0, decrypt_round);
+        message.resetDecrypted();
+
+        Pacing::pause(5);
+        message.resetMessageDecrypted();
+    }
+
     void truncate_decrypt_message()
     {
         int root = static_cast<int>(sqrt(message.getDecryptedMessage().length()));
-
-        if (root * root < static_cast<int>(message.getDecryptedMessage().length()))
-        {
-            string temp = message.getDecryptedMessage().substr(0, root * root);
-            message.setUserMessage(temp);
-        }
-        else
-        {
-            message.setUserMessage(message.getDecryptedMessage());
-        }
+        message.promoteDecrypted(root * root);
     }
 
     string getMessageDecrypt() const { return message.getTempMessage(); }
@@ -656,241 +557,403 @@ public:
     void setUserChoice(int temp) { userChoice = temp; }
 };
 
-// Updated menu functions take AppContext& instead of separate encryptor/decryptor
-void menu1(AppContext &ctx);
-void menu2_encrypt(AppContext &ctx);
-void menu3_encrypt_oneRound(AppContext &ctx);
-void menu3_encrypt_multi(AppContext &ctx);
-void menu2_decrypt(AppContext &ctx);
+// Interactive menu, driven by the state table below
+void run_menu(AppContext &ctx);
 
-int main()
+// Non-interactive modes selected by command-line flags
+int command_line(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
 {
-    srand(static_cast<unsigned int>(time(0)));
+    if (argc > 1)
+        return command_line(argc, argv);
 
     AppContext ctx; // struct that holds are functionalities
-    menu1(ctx);     // starting off with menu 1
+    try
+    {
+        run_menu(ctx); // starting off with the main menu
+    }
+    catch (const EndOfInput &)
+    {
+        cout << endl;
+    }
 
     cout << "Thank you for using the encryption program!" << endl;
     return 0;
 }
 
-void no_message(AppContext &ctx, int option)
+// Menu states; Quit ends the dispatch loop
+enum class MenuState
 {
-    if (ctx.getEncryptor().getMessage().getMessageLength() == 0 && option == 1)
-    {
-        cout << "Enter a message first" << endl;
-        this_thread::sleep_for(chrono::seconds(2));
-        system("clear");
-        menu1(ctx);
-        return;
-    }
-    if (ctx.getDecryptor().getMessageDecrypt().length() == 0 && option == 2)
-    {
-        cout << "Enter a message first" << endl;
-        this_thread::sleep_for(chrono::seconds(2));
-        system("clear");
-        menu1(ctx);
-        return;
-    }
-}
+    Main,
+    Encrypt,
+    EncryptOneRound,
+    EncryptMulti,
+    Decrypt,
+    Quit
+};
 
-// Example menu1 implementation
-void menu1(AppContext &ctx)
+// One menu option: an optional guard that allows it, an optional action, and the state to go to.
+// When the guard refuses the user is sent back to the main menu instead.
+struct MenuTransition
 {
-    MenuContext context(printMenu1, 3);
+    bool (*allowed)(AppContext &);
+    void (*action)(AppContext &);
+    MenuState next;
+};
 
-    while (true)
-    {
-        system("clear");
-        printMenu1();
-        try
-        {
-            context.errorHandling(); // Throws on invalid inpu∫t
-            break;                   // Valid input, exit loop
-        }
-        catch (const CustomException &e)
-        {
-            cout << "Error: " << e.what() << endl;
-            cout << "Please try again." << endl;
-            this_thread::sleep_for(chrono::seconds(1)); // Optional pause for readability
-        }
-    }
+struct MenuStateSpec
+{
+    void (*printMenuFunc)();
+    vector<MenuTransition> options; // option n is options[n - 1]
+};
 
-    ctx.setInput(context.inputBuffer);
-    ctx.setUserChoice(context.userChoice);
+bool has_message_to_encrypt(AppContext &ctx) { return ctx.getEncryptor().getMessage().getMessageLength() != 0; }
+bool has_message_to_decrypt(AppContext &ctx) { return !ctx.getDecryptor().getMessageDecrypt().empty(); }
 
-    switch (ctx.getUserChoice())
-    {
-    case 1:
-        menu2_encrypt(ctx);
-        break;
-    case 2:
-        menu2_decrypt(ctx);
-        break;
-    case 3:
-        system("clear");
-        cout << "Quitting..." << endl;
-        exit(0);
-    }
+// The whole menu system as data: states, options and transitions
+const vector<MenuStateSpec> &menu_table()
+{
+    static const vector<MenuStateSpec> table = {
+        // Main
+        {printMenu1,
+         {{nullptr, nullptr, MenuState::Encrypt},
+          {nullptr, nullptr, MenuState::Decrypt},
+          {nullptr, nullptr, MenuState::Quit}}},
+        // Encrypt
+        {printMenu2_encrypt,
+         {{nullptr, [](AppContext &ctx) { ctx.getEncryptor().getMessage().addMessage(); }, MenuState::Encrypt},
+          {has_message_to_encrypt, nullptr, MenuState::EncryptOneRound},
+          {has_message_to_encrypt, nullptr, MenuState::EncryptMulti},
+          {nullptr, nullptr, MenuState::Main}}},
+        // EncryptOneRound
+        {printMenu3_encrypt_oneRound,
+         {{nullptr, [](AppContext &ctx) { ctx.getEncryptor().getClassGrid().addGrid(); }, MenuState::EncryptOneRound},
+          {nullptr, [](AppContext &ctx) { ctx.getEncryptor().getClassGrid().autoGridSize(); }, MenuState::EncryptOneRound},
+          {nullptr, [](AppContext &ctx) { ctx.getEncryptor().encryptAndDisplay(); Pacing::pause(5); }, MenuState::EncryptOneRound},
+          {nullptr, nullptr, MenuState::Encrypt}}},
+        // EncryptMulti
+        {printMenu3_encrypt_multi,
+         {{nullptr, [](AppContext &ctx) { ctx.getEncryptor().addEncryptRound(); }, MenuState::EncryptMulti},
+          {nullptr, [](AppContext &ctx) { ctx.getEncryptor().multi_encryption(); }, MenuState::EncryptMulti},
+          {nullptr, [](AppContext &ctx) { ctx.getEncryptor().composed_encryption(); }, MenuState::EncryptMulti},
+          {nullptr, nullptr, MenuState::Encrypt}}},
+        // Decrypt
+        {printMenu2_decrypt,
+         {{nullptr, [](AppContext &ctx) { ctx.getDecryptor().addMessage(); }, MenuState::Decrypt},
+          {nullptr, [](AppContext &ctx) { ctx.getDecryptor().addDecryptRound(); }, MenuState::Decrypt},
+          {has_message_to_decrypt, [](AppContext &ctx) { ctx.getDecryptor().multi_decryption(); }, MenuState::Decrypt},
+          {has_message_to_decrypt, [](AppContext &ctx) { ctx.getDecryptor().composed_decryption(); }, MenuState::Decrypt},
+          {nullptr, nullptr, MenuState::Main}}},
+    };
+    return table;
 }
 
-void menu2_encrypt(AppContext &ctx)
+// Single dispatch loop: constant stack depth however long the session runs
+void run_menu(AppContext &ctx)
 {
-    MenuContext context(printMenu2_encrypt, 4);
+    MenuState state = MenuState::Main;
 
-    while (true)
+    while (state != MenuState::Quit)
     {
-        system("clear");
+        const MenuStateSpec &spec = menu_table()[static_cast<int>(state)];
+        MenuContext context(spec.printMenuFunc, static_cast<int>(spec.options.size()));
+
+        Pacing::clearScreen();
         context.printMenuFunc();
-        context.inputBuffer = ctx.getInput();
         try
         {
             context.errorHandling(); // Throws on invalid input
+            ctx.setInput(context.inputBuffer);
+            ctx.setUserChoice(context.userChoice);
 
-            switch (context.userChoice)
+            const MenuTransition &transition = spec.options[context.userChoice - 1];
+            if (transition.allowed != nullptr && !transition.allowed(ctx))
             {
-            case 1:
-                ctx.getEncryptor().getMessage().addMessage();
-                break;
-            case 2:
-                menu3_encrypt_oneRound(ctx);
-                return;
-            case 3:
-                menu3_encrypt_multi(ctx);
-                return;
-            case 4:
-                menu1(ctx);
-                return;
+                cout << "Enter a message first" << endl;
+                Pacing::pause(2);
+                state = MenuState::Main;
+                continue;
             }
+
+            if (transition.action != nullptr)
+                transition.action(ctx);
+            state = transition.next;
         }
         catch (const CustomException &e)
         {
             cout << "Error: " << e.what() << endl;
+            SessionReport::error(e.what());
             cout << "Please try again." << endl;
-            this_thread::sleep_for(chrono::seconds(1)); // Optional pause for readability
+            Pacing::pause(1); // Optional pause for readability
         }
     }
+
+    Pacing::clearScreen();
+    cout << "Quitting..." << endl;
+}
+
+void print_usage()
+{
+    cout << "Usage: encryption-decryption [--encode | --decode] [--block N] [--rounds N] [--threads N]" << endl;
+    cout << "                             [--in FILE --out FILE] [--seed N] [--binary] [--compact N] [--metrics FORMAT]" << endl;
+    cout << "       encryption-decryption --serve SOCKET [--threads N]" << endl;
+    cout << "       encryption-decryption --script FILE" << endl;
+    cout << "       encryption-decryption --connect SOCKET [--encode | --decode] [--rounds N] [--binary] [--repeat N]" << endl;
+    cout << "  Streams stdin to stdout in fixed-size diamond blocks." << endl;
+    cout << "  --block N   plaintext characters per block (default 1024)" << endl;
+    cout << "  --rounds N  encryption rounds per block (default 1)" << endl;
+    cout << "  --threads N worker threads encoding blocks in parallel (default 1)" << endl;
+    cout << "  --in FILE --out FILE  memory-map the files instead of streaming" << endl;
+    cout << "  --seed N    reproducible filler characters" << endl;
+    cout << "  --binary    any bytes as payload, byte filler (default: letters and full stops)" << endl;
+    cout << "  --compact N emit only the diamond cells plus at most N filler cells per round, so" << endl;
+    cout << "              rounds grow the output linearly; decode needs the same N" << endl;
+    cout << "  --serve SOCKET    run the codec daemon on a Unix domain socket" << endl;
+    cout << "  --connect SOCKET  send stdin to the daemon as one message" << endl;
+    cout << "  --repeat N  send it N times and report p50/p99 latency on stderr" << endl;
+    cout << "  --metrics json|prometheus  record codec metrics and print them to stderr at exit" << endl;
+    cout << "  --script FILE  replay menu input from FILE (- for stdin) without pauses or screen" << endl;
+    cout << "                 clears; results are printed as JSON lines" << endl;
+    cout << "Run without arguments for the interactive menu." << endl;
+}
+
+int parse_positive(const string &text)
+{
+    istringstream iss(text);
+    int value;
+
+    if (!(iss >> value) || !(iss.eof()) || value <= 0)
+        throw CustomException("Expected a number greater than 0, got '" + text + "'", true);
+
+    return value;
+}
+
+int parse_count(const string &text)
+{
+    istringstream iss(text);
+    int value;
+
+    if (!(iss >> value) || !(iss.eof()) || value < 0)
+        throw CustomException("Expected a number of 0 or more, got '" + text + "'", true);
+
+    return value;
 }
 
-void menu3_encrypt_oneRound(AppContext &ctx)
+unsigned long long parse_seed(const string &text)
 {
-    MenuContext context(printMenu3_encrypt_oneRound, 4);
-    bool stayInMenu = true;
+    istringstream iss(text);
+    unsigned long long value;
+
+    if (text.empty() || text[0] == '-' || !(iss >> value) || !(iss.eof()))
+        throw CustomException("Expected a seed number, got '" + text + "'", true);
 
-    no_message(ctx, 1);
+    return value;
+}
 
-    while (stayInMenu)
+// Menu session driven by a file of choices and inputs, one per line
+int run_script(const string &path)
+{
+    ifstream file;
+    streambuf *input = cin.rdbuf();
+    if (path != "-")
     {
-        system("clear");
-        context.printMenuFunc();
-        try
-        {
-            context.errorHandling(); // Throws on invalid input
-            ctx.setInput(context.inputBuffer);
+        file.open(path);
+        if (!file)
+            throw CustomException("Cannot open script '" + path + "'", true);
+        input = file.rdbuf();
+    }
 
-            switch (context.userChoice)
-            {
-            case 1:
-                ctx.getEncryptor().getClassGrid().addGrid();
-                break;
-            case 2:
-                ctx.getEncryptor().getClassGrid().autoGridSize();
-                break;
-            case 3:
-                ctx.getEncryptor().encryptAndDisplay();
-                this_thread::sleep_for(chrono::seconds(5));
-                break;
+    // Menu text is dropped; only the JSON lines reach stdout
+    ostream results(cout.rdbuf());
+    streambuf *savedIn = cin.rdbuf(input);
+    streambuf *savedOut = cout.rdbuf(nullptr);
+    Pacing::setInteractive(false);
+    SessionReport::setTarget(&results);
 
-                break;
-            case 4:
-                menu2_encrypt(ctx);
-                return;
-            }
-        }
-        catch (const CustomException &e)
-        {
-            cout << "Error: " << e.what() << endl;
-            cout << "Please try again." << endl;
-            this_thread::sleep_for(chrono::seconds(1)); // Optional pause for readability
-        }
+    AppContext ctx;
+    try
+    {
+        run_menu(ctx);
+    }
+    catch (const EndOfInput &)
+    {
     }
+
+    SessionReport::setTarget(nullptr);
+    Pacing::setInteractive(true);
+    cout.rdbuf(savedOut);
+    cout.clear();
+    cin.rdbuf(savedIn);
+    return 0;
 }
 
-void menu3_encrypt_multi(AppContext &ctx)
+diamond::CodecServer *running_server = nullptr;
+
+void stop_server(int)
 {
-    MenuContext context(printMenu3_encrypt_multi, 3);
-    bool stayInMenu = true;
+    if (running_server != nullptr)
+        running_server->stop();
+}
 
-    no_message(ctx, 1);
+int serve(const string &socketPath, int threads)
+{
+    diamond::CodecServer server(socketPath, threads);
+    running_server = &server;
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+
+    cerr << "Listening on " << socketPath << endl;
+    server.run();
+    running_server = nullptr;
+    cerr << "Served " << server.getServedCount() << " requests" << endl;
+    return 0;
+}
 
-    while (stayInMenu)
+int connect_client(const string &socketPath, const diamond::StreamOptions &options, bool decode, int repeat)
+{
+    string input((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+    if (!options.binary)
     {
-        system("clear");
-        context.printMenuFunc();
-        ctx.setInput(context.inputBuffer);
+        input.erase(input.find_last_not_of(" \t\n\r") + 1);
+        input = diamond::normalize(input);
+    }
 
-        try
-        {
-            context.errorHandling(); // Throws on invalid input
+    diamond::CodecClient client(socketPath);
+    diamond::Alphabet alphabet = options.binary ? diamond::Alphabet::Bytes : diamond::Alphabet::Letters;
+    // Binary input has no '.' to stop at, so it travels as a frame that records its length
+    uint8_t op = options.binary ? (decode ? diamond::wire::Unframe : diamond::wire::Frame)
+                                : (decode ? diamond::wire::Decode : diamond::wire::Encode);
 
-            switch (context.userChoice)
-            {
-            case 1:
-                ctx.getEncryptor().addEncryptRound();
-                break;
-            case 2:
-                ctx.getEncryptor().multi_encryption();
-                break;
-            case 3:
-                menu2_encrypt(ctx);
-                return;
-            }
-        }
-        catch (const CustomException &e)
-        {
-            cout << "Error: " << e.what() << endl;
-            cout << "Please try again." << endl;
-            this_thread::sleep_for(chrono::seconds(1)); // Optional pause for readability
-        }
+    string result;
+    vector<double> latencies; // microseconds
+    for (int i = 0; i < repeat; i++)
+    {
+        auto start = chrono::steady_clock::now();
+        result = client.call(op, options.rounds, input, alphabet);
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
     }
+
+    cout.write(result.data(), result.size());
+    if (!options.binary)
+        cout << endl;
+
+    if (repeat > 1)
+    {
+        sort(latencies.begin(), latencies.end());
+        cerr << fixed << setprecision(1)
+             << "p50 " << latencies[latencies.size() / 2] << " us, "
+             << "p99 " << latencies[latencies.size() * 99 / 100] << " us over " << repeat << " requests" << endl;
+    }
+    return 0;
 }
 
-void menu2_decrypt(AppContext &ctx)
+// Dumps the metrics on the way out of command_line, whichever path returns
+struct MetricsDump
 {
-    MenuContext context(printMenu2_decrypt, 4);
-    bool stayInMenu = true;
+    string format;
 
-    while (stayInMenu)
+    ~MetricsDump()
     {
-        system("clear");
-        context.printMenuFunc();
-        ctx.setInput(context.inputBuffer);
-        try
-        {
-            context.errorHandling(); // Throws on invalid input
+        if (format == "json")
+            cerr << diamond::Metrics::toJson() << endl;
+        else if (format == "prometheus")
+            cerr << diamond::Metrics::toPrometheus();
+    }
+};
 
-            switch (context.userChoice)
+int command_line(int argc, char *argv[])
+{
+    MetricsDump metrics;
+    try
+    {
+        diamond::StreamOptions options;
+        bool decode = false;
+        string inPath, outPath, servePath, connectPath, scriptPath;
+        int repeat = 1;
+
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg == "--encode")
+                decode = false;
+            else if (arg == "--decode")
+                decode = true;
+            else if (arg == "--block" && i + 1 < argc)
+                options.block_size = parse_positive(argv[++i]);
+            else if (arg == "--rounds" && i + 1 < argc)
+                options.rounds = parse_positive(argv[++i]);
+            else if (arg == "--threads" && i + 1 < argc)
+                options.threads = parse_positive(argv[++i]);
+            else if (arg == "--in" && i + 1 < argc)
+                inPath = argv[++i];
+            else if (arg == "--out" && i + 1 < argc)
+                outPath = argv[++i];
+            else if (arg == "--binary")
+                options.binary = true;
+            else if (arg == "--compact" && i + 1 < argc)
+                options.filler = parse_count(argv[++i]);
+            else if (arg == "--script" && i + 1 < argc)
+                scriptPath = argv[++i];
+            else if (arg == "--serve" && i + 1 < argc)
+                servePath = argv[++i];
+            else if (arg == "--connect" && i + 1 < argc)
+                connectPath = argv[++i];
+            else if (arg == "--repeat" && i + 1 < argc)
+                repeat = parse_positive(argv[++i]);
+            else if (arg == "--metrics" && i + 1 < argc)
             {
-            case 1:
-                ctx.getDecryptor().addMessage();
-                break;
-            case 2:
-                ctx.getDecryptor().addDecryptRound();
-                break;
-            case 3:
-                no_message(ctx, 2); // check if the message decrypt is in there
-                ctx.getDecryptor().multi_decryption();
-                break;
-            case 4:
-                menu1(ctx);
-                return;
+                metrics.format = argv[++i];
+                if (metrics.format != "json" && metrics.format != "prometheus")
+                    throw CustomException("Metrics format must be json or prometheus", true);
+                diamond::Metrics::enable();
+            }
+            else if (arg == "--seed" && i + 1 < argc)
+            {
+                options.seeded = true;
+                options.seed = parse_seed(argv[++i]);
+            }
+            else
+            {
+                print_usage();
+                return arg == "--help" ? 0 : 1;
             }
         }
-        catch (const CustomException &e)
+
+        if (!scriptPath.empty())
+            return run_script(scriptPath);
+
+        if (!servePath.empty())
+            return serve(servePath, options.threads);
+
+        if (!connectPath.empty())
+            return connect_client(connectPath, options, decode, repeat);
+
+        if (!inPath.empty() || !outPath.empty())
         {
-            cout << "Error: " << e.what() << endl;
-            cout << "Please try again." << endl;
-            this_thread::sleep_for(chrono::seconds(1)); // Optional pause for readability
+            if (inPath.empty() || outPath.empty())
+                throw CustomException("File mode needs both --in and --out", true);
+
+            diamond::FileCodec files(options);
+            if (decode)
+                files.decode(inPath, outPath);
+            else
+                files.encode(inPath, outPath);
+            return 0;
         }
+
+        // Reading, coding and writing overlap on separate threads
+        ios::sync_with_stdio(false);
+        diamond::BlockPipeline stream(options);
+        if (decode)
+            stream.decode(cin, cout);
+        else
+            stream.encode(cin, cout);
     }
+    catch (const CustomException &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
 }
@@ -0,0 +1,187 @@
+#ifndef BATCH_CODEC_HPP
+#define BATCH_CODEC_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+#include "work_stealing_pool.hpp"
+
+using namespace std;
+
+namespace diamond
+{
+    // Batch engine for large numbers of short messages.
+    // Messages are bucketed by the grid size the encoder picks for them. Every message of a
+    // bucket follows the composed permutation of a message that fills the whole diamond (the
+    // characters a shorter message lacks are simply filler), so a bucket looks its map up
+    // once. Each ciphertext is then filled with filler in one long call, which takes the
+    // generator's block path, and the message characters are stored over it; per-message
+    // encoding instead gathers every cell and fills each short filler run separately.
+    // Ciphertexts are interchangeable with encode()/decode() for the same rounds, alphabet
+    // and filler count.
+    class BatchCodec
+    {
+    public:
+        static constexpr size_t CHUNK = 256; // messages per task
+
+    private:
+        // Consecutive messages of one bucket
+        struct Chunk
+        {
+            int key; // grid size when encoding, ciphertext length when decoding
+            const size_t *indices;
+            size_t count;
+        };
+
+        int rounds;
+        bool seeded = false;
+        uint64_t seed = 0;
+        Alphabet alphabet = Alphabet::Letters;
+        int filler = FULL_GRID;
+        unique_ptr<WorkStealingPool> pool;
+        map<int, vector<size_t>> buckets; // key -> message indices, kept from the last run
+
+        // Group the indices by key and cut every bucket into chunks
+        template <typename Key>
+        vector<Chunk> plan(size_t count, Key key)
+        {
+            buckets.clear();
+            for (size_t i = 0; i < count; i++)
+                buckets[key(i)].push_back(i);
+
+            vector<Chunk> chunks;
+            for (const auto &bucket : buckets)
+                for (size_t first = 0; first < bucket.second.size(); first += CHUNK)
+                    chunks.push_back({bucket.first, bucket.second.data() + first, min(CHUNK, bucket.second.size() - first)});
+            return chunks;
+        }
+
+        // Filler depends only on the seed and the chunk, whichever worker runs it
+        template <typename Body>
+        void run(const vector<Chunk> &chunks, Body body)
+        {
+            auto task = [&](size_t c)
+            {
+                if (seeded)
+                    seedFiller(seed, c);
+                body(chunks[c]);
+            };
+            if (pool)
+                pool->forkJoin(chunks.size(), task);
+            else
+                for (size_t c = 0; c < chunks.size(); c++)
+                    task(c);
+        }
+
+        static void recordEncode(const RoundMap &map, size_t count, size_t bytes_in)
+        {
+            if (!Metrics::enabled())
+                return;
+            size_t cells = static_cast<size_t>(map.getOutputLength()) * count;
+            Metrics::add(Metrics::EncodeCalls, count);
+            Metrics::add(Metrics::BytesIn, bytes_in);
+            Metrics::add(Metrics::BytesOut, cells);
+            Metrics::add(Metrics::OutputCells, cells);
+            Metrics::add(Metrics::FillerCells, cells - bytes_in);
+            for (int size : map.getGridSizes())
+                for (size_t m = 0; m < count; m++)
+                    Metrics::gridSize(size);
+        }
+
+        void encodeChunk(const vector<string> &messages, const Chunk &chunk, vector<string> &results) const
+        {
+            int diamond_size = chunk.key * chunk.key / 2 + 1;
+            shared_ptr<const RoundMap> map = RoundMap::encoding(diamond_size, rounds, filler);
+            int length = map->getOutputLength();
+
+            // Ciphertext position of every diamond character
+            thread_local vector<int> positions;
+            positions.resize(diamond_size);
+            for (int p = 0; p < length; p++)
+                if ((*map)[p] != RoundMap::FILLER)
+                    positions[(*map)[p]] = p;
+
+            FillerRng &rng = FillerRng::local();
+            size_t bytes_in = 0;
+            for (size_t m = 0; m < chunk.count; m++)
+            {
+                const string &msg = messages[chunk.indices[m]];
+                string &result = results[chunk.indices[m]];
+                result.resize(length);
+                if (alphabet == Alphabet::Bytes)
+                    rng.fillBytes(&result[0], length);
+                else
+                    rng.fillLetters(&result[0], length);
+                for (size_t k = 0; k < msg.size(); k++)
+                    result[positions[k]] = msg[k];
+                bytes_in += msg.size();
+            }
+            recordEncode(*map, chunk.count, bytes_in);
+        }
+
+        void decodeChunk(const vector<string> &ciphers, const Chunk &chunk, bool stopAtDot, vector<string> &results) const
+        {
+            shared_ptr<const RoundMap> map = RoundMap::decoding(chunk.key, rounds, filler);
+            int length = map->getOutputLength();
+            for (size_t m = 0; m < chunk.count; m++)
+            {
+                string &result = results[chunk.indices[m]];
+                result.resize(length);
+                map->getPlan().apply(ciphers[chunk.indices[m]].data(), &result[0]);
+                result.resize(keptLength(result.data(), length, stopAtDot));
+                recordDecode(chunk.key, result.size());
+            }
+        }
+
+    public:
+        // threads > 1 spreads the chunks over a work-stealing pool
+        explicit BatchCodec(int roundCount, int threads = 1) : rounds(roundCount)
+        {
+            if (rounds < 1)
+                throw CustomException("Round number must be greater than 0", true);
+            if (threads > 1)
+                pool.reset(new WorkStealingPool(threads));
+        }
+
+        // Filler depends only on the seed and the batch, not on the number of threads
+        void setSeed(uint64_t value)
+        {
+            seeded = true;
+            seed = value;
+        }
+
+        void setAlphabet(Alphabet value) { alphabet = value; }
+        void setFiller(int value) { filler = value; }
+
+        // Encrypt every message; results[i] is the ciphertext of messages[i]
+        void encode(const vector<string> &messages, vector<string> &results)
+        {
+            // Every grid size is checked before any work starts
+            vector<Chunk> chunks = plan(messages.size(), [&](size_t i)
+                                        { return gridSizeFor(static_cast<int>(messages[i].size())); });
+            results.resize(messages.size());
+            run(chunks, [&](const Chunk &chunk)
+                { encodeChunk(messages, chunk, results); });
+        }
+
+        // Decrypt every ciphertext, stopping after the first '.' unless told otherwise.
+        // Ciphertexts are bucketed by length, which fixes the grid size of every round.
+        void decode(const vector<string> &ciphers, bool stopAtDot, vector<string> &results)
+        {
+            vector<Chunk> chunks = plan(ciphers.size(), [&](size_t i)
+                                        { return static_cast<int>(ciphers[i].size()); });
+            results.resize(ciphers.size());
+            run(chunks, [&](const Chunk &chunk)
+                { decodeChunk(ciphers, chunk, stopAtDot, results); });
+        }
+
+        // Buckets of the last run: grid size (or ciphertext length) -> message indices
+        const map<int, vector<size_t>> &getBuckets() const { return buckets; }
+    };
+}
+
+#endif // BATCH_CODEC_HPP
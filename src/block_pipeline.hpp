@@ -0,0 +1,204 @@
+#ifndef BLOCK_PIPELINE_HPP
+#define BLOCK_PIPELINE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+#include "parallel_codec.hpp"
+#include "block_stream.hpp"
+#include "bounded_queue.hpp"
+
+using namespace std;
+
+namespace diamond
+{
+    // Splits an arbitrarily long stream into fixed-size diamond blocks (format in
+    // block_stream.hpp) as a three-stage pipeline: a reader thread cuts blocks,
+    // worker threads encode or decode them, and the calling thread writes them back in
+    // order. Bounded queues between the stages give backpressure, so reading, coding and
+    // writing overlap without buffering more than a few blocks per worker.
+    class BlockPipeline
+    {
+    private:
+        static const size_t STOP = static_cast<size_t>(-1); // tells a worker to exit
+
+        struct Job
+        {
+            size_t index = 0;
+            bool final = false; // the short block that ends the stream
+            string text;
+        };
+
+        StreamOptions options;
+        ParallelCodec codec; // seeding and alphabet only; the pipeline owns its threads
+        int workers;
+        size_t queue_capacity;
+        PipelineGuard guard;
+        size_t block_count = 0;
+
+        template <typename Read, typename Transform>
+        void run(Read read, Transform transform, istream &in, ostream &out)
+        {
+            // Reads on the reader thread must not flush out (cin is tied to cout) while
+            // this thread writes to it
+            struct Untie
+            {
+                istream &stream;
+                ostream *tied;
+                explicit Untie(istream &s) : stream(s), tied(s.tie(nullptr)) {}
+                ~Untie() { stream.tie(tied); }
+            } untie(in);
+
+            guard.reset();
+            BoundedQueue<Job> input(queue_capacity), output(queue_capacity);
+
+            thread reader([&]
+                          { guard.run([&]
+                                        {
+                                            read(input);
+                                            for (int i = 0; i < workers; i++)
+                                            {
+                                                Job stop;
+                                                stop.index = STOP;
+                                                if (!guard.push(input, stop))
+                                                    return;
+                                            } }); });
+
+            vector<thread> pool;
+            for (int i = 0; i < workers; i++)
+                pool.emplace_back([&]
+                                  { guard.run([&]
+                                                {
+                                                    Job job;
+                                                    while (guard.pop(input, job) && job.index != STOP)
+                                                    {
+                                                        transform(job);
+                                                        if (!guard.push(output, job))
+                                                            return;
+                                                    } }); });
+
+            // Writer: blocks come back out of order, at most a queue's worth ahead
+            guard.run([&]
+                        {
+                            map<size_t, Job> pending;
+                            size_t next = 0;
+                            bool done = false;
+                            Job job;
+                            while (!done && guard.pop(output, job))
+                            {
+                                size_t index = job.index;
+                                pending[index] = move(job);
+                                for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), next++)
+                                {
+                                    out.write(it->second.text.data(), it->second.text.size());
+                                    done = it->second.final;
+                                }
+                            }
+                            out.flush();
+                            block_count = next; });
+
+            reader.join();
+            for (thread &worker : pool)
+                worker.join();
+            guard.rethrow();
+        }
+
+    public:
+        explicit BlockPipeline(const StreamOptions &opts)
+            : options(opts), codec(1), workers(max(opts.threads, 1)), queue_capacity(4 * max(opts.threads, 1))
+        {
+            if (options.seeded)
+                codec.setSeed(options.seed);
+            if (options.binary)
+                codec.setAlphabet(Alphabet::Bytes);
+            codec.setFiller(options.filler);
+
+            if (options.block_size <= 0)
+                throw CustomException("Block size must be greater than 0", true);
+            encodedLength(options.block_size, options.rounds, options.filler);
+        }
+
+        void encode(istream &in, ostream &out)
+        {
+            auto read = [&](BoundedQueue<Job> &input)
+            {
+                ChunkReader reader(in);
+                for (size_t index = 0;; index++)
+                {
+                    Job job;
+                    job.index = index;
+                    job.text.reserve(options.block_size + 1);
+                    readPlainBlock(reader, job.text, options.block_size, options.binary);
+                    if (static_cast<int>(job.text.size()) < options.block_size)
+                    {
+                        job.text += '.';
+                        job.final = true;
+                    }
+                    bool final = job.final;
+                    if (!guard.push(input, job) || final)
+                        return;
+                }
+            };
+
+            auto transform = [&](Job &job)
+            {
+                codec.seedBlock(job.index);
+                job.text = diamond::encode(job.text, options.rounds, codec.getAlphabet(), options.filler);
+            };
+
+            run(read, transform, in, out);
+        }
+
+        void decode(istream &in, ostream &out)
+        {
+            size_t cipher_block = encodedLength(options.block_size, options.rounds, options.filler);
+
+            // One block of lookahead tells the final block apart
+            auto read = [&](BoundedQueue<Job> &input)
+            {
+                ChunkReader reader(in);
+                Job current;
+                readCipherBlock(reader, current.text, cipher_block, options.binary);
+                if (current.text.empty())
+                    throw CustomException("Ciphertext stream is empty", true);
+
+                for (size_t index = 0;; index++)
+                {
+                    Job next;
+                    readCipherBlock(reader, next.text, cipher_block, options.binary);
+                    current.index = index;
+                    current.final = next.text.empty();
+                    bool final = current.final;
+                    if (!guard.push(input, current) || final)
+                        return;
+                    current = move(next);
+                }
+            };
+
+            auto transform = [&](Job &job)
+            {
+                string text = diamond::decode(job.text, options.rounds, false, options.filler);
+                if (job.final)
+                {
+                    size_t end = text.rfind('.');
+                    if (end == string::npos)
+                        throw CustomException("Ciphertext stream is missing its final block", true);
+                    text.resize(end);
+                }
+                else
+                    text.resize(options.block_size);
+                job.text.swap(text);
+            };
+
+            run(read, transform, in, out);
+        }
+
+        size_t getBlockCount() const { return block_count; }
+    };
+}
+
+#endif // BLOCK_PIPELINE_HPP
@@ -0,0 +1,92 @@
+#ifndef BLOCK_STREAM_HPP
+#define BLOCK_STREAM_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cctype>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+
+using namespace std;
+
+namespace diamond
+{
+    struct StreamOptions
+    {
+        int block_size = 1024; // plaintext characters per block
+        int rounds = 1;        // rounds applied to every block
+        int threads = 1;       // workers encoding or decoding blocks
+        bool seeded = false;   // reproducible filler from seed
+        uint64_t seed = 0;
+        bool binary = false;   // bytes taken as-is, byte filler
+        int filler = FULL_GRID; // FULL_GRID, or compact layout with this many filler cells per round
+    };
+
+    // Block stream format shared by BlockPipeline and FileCodec. Every full block holds
+    // exactly block_size plaintext characters; the stream always ends with one short block
+    // carrying the remainder and a '.' terminator. Filler never contains '.', so the last
+    // '.' of the final block marks the end. In binary mode every byte is payload: nothing
+    // is skipped, validated or uppercased.
+
+    // Buffered character source over an istream
+    class ChunkReader
+    {
+    private:
+        istream &in;
+        vector<char> buffer;
+        size_t position = 0;
+        size_t filled = 0;
+
+    public:
+        explicit ChunkReader(istream &input, size_t chunk = 1 << 16) : in(input), buffer(chunk) {}
+
+        bool next(char &c)
+        {
+            if (position == filled)
+            {
+                in.read(buffer.data(), buffer.size());
+                filled = static_cast<size_t>(in.gcount());
+                position = 0;
+                if (filled == 0)
+                    return false;
+            }
+            c = buffer[position++];
+            return true;
+        }
+    };
+
+    inline bool isStreamSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    // Read up to count plaintext characters; unless binary, whitespace is skipped and
+    // the rest is validated and uppercased. Fewer than count means the input is exhausted.
+    inline void readPlainBlock(ChunkReader &reader, string &block, size_t count, bool binary)
+    {
+        block.clear();
+        char c;
+        while (block.size() < count && reader.next(c))
+        {
+            if (!binary)
+            {
+                if (isStreamSpace(c))
+                    continue;
+                c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+                if (!(isalpha(static_cast<unsigned char>(c)) || c == '.'))
+                    throw CustomException("Input must contain only letters (A-Z or a-z) and full stops.", true);
+            }
+            block += c;
+        }
+    }
+
+    // Read up to count ciphertext characters, skipping whitespace unless binary
+    inline void readCipherBlock(ChunkReader &reader, string &block, size_t count, bool binary)
+    {
+        block.clear();
+        char c;
+        while (block.size() < count && reader.next(c))
+            if (binary || !isStreamSpace(c))
+                block += c;
+    }
+}
+
+#endif // BLOCK_STREAM_HPP
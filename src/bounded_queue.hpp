@@ -0,0 +1,194 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+using namespace std;
+
+namespace diamond
+{
+    // Bounded multi-producer multi-consumer queue without locks (Vyukov's ring).
+    // Each cell carries a sequence number that tells producers and consumers whose turn it is.
+    template <typename T>
+    class BoundedQueue
+    {
+    private:
+        struct Cell
+        {
+            atomic<size_t> sequence;
+            T value;
+        };
+
+        unique_ptr<Cell[]> cells;
+        size_t mask;
+        alignas(64) atomic<size_t> enqueue_position{0};
+        alignas(64) atomic<size_t> dequeue_position{0};
+
+    public:
+        // Capacity is rounded up to a power of two
+        explicit BoundedQueue(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+            cells.reset(new Cell[size]);
+            mask = size - 1;
+            for (size_t i = 0; i < size; i++)
+                cells[i].sequence.store(i, memory_order_relaxed);
+        }
+
+        // Moves value in and returns true, or returns false when full
+        bool tryPush(T &value)
+        {
+            size_t position = enqueue_position.load(memory_order_relaxed);
+            while (true)
+            {
+                Cell &cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (diff == 0)
+                {
+                    if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                    {
+                        cell.value = move(value);
+                        cell.sequence.store(position + 1, memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    position = enqueue_position.load(memory_order_relaxed);
+            }
+        }
+
+        // Moves the oldest value out and returns true, or returns false when empty
+        bool tryPop(T &value)
+        {
+            size_t position = dequeue_position.load(memory_order_relaxed);
+            while (true)
+            {
+                Cell &cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                if (diff == 0)
+                {
+                    if (dequeue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                    {
+                        value = move(cell.value);
+                        cell.sequence.store(position + mask + 1, memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    position = dequeue_position.load(memory_order_relaxed);
+            }
+        }
+    };
+
+    // Failure handling shared by the stages of a pipeline: the first exception is kept,
+    // every stage stops, and blocking queue operations give up once the pipeline failed.
+    // A stage that finds its queue full or empty sleeps until another stage moves something.
+    class PipelineGuard
+    {
+    private:
+        atomic<bool> aborted{false};
+        mutex error_mutex;
+        exception_ptr error;
+        mutex park_mutex;
+        condition_variable moved;
+        atomic<int> parked{0};
+
+        // Wakes parked stages; cheap when none is parked. Reading the count with a
+        // read-modify-write orders it against park()'s increment.
+        void wake()
+        {
+            if (parked.fetch_add(0) == 0)
+                return;
+            {
+                lock_guard<mutex> lock(park_mutex);
+            }
+            moved.notify_all();
+        }
+
+        // Retry attempt until it succeeds or the pipeline fails, sleeping in between.
+        // The parked count is raised before the retry, so a stage that moves something
+        // after the failed retry sees it and wakes us.
+        template <typename Attempt>
+        bool park(Attempt attempt)
+        {
+            unique_lock<mutex> lock(park_mutex);
+            parked.fetch_add(1);
+            bool done = false;
+            moved.wait(lock, [&]
+                       { return (done = attempt()) || aborted.load(); });
+            parked.fetch_sub(1);
+            return done;
+        }
+
+    public:
+        void reset()
+        {
+            aborted = false;
+            error = nullptr;
+        }
+
+        // Run body, recording the first failure and stopping every stage
+        template <typename Body>
+        void run(Body body)
+        {
+            try
+            {
+                body();
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(error_mutex);
+                if (!error)
+                    error = current_exception();
+                aborted = true;
+            }
+            {
+                lock_guard<mutex> lock(park_mutex);
+            }
+            moved.notify_all();
+        }
+
+        // Blocking push and pop: wait until there is room or data, or the pipeline fails
+        template <typename T>
+        bool push(BoundedQueue<T> &queue, T &value)
+        {
+            if (!queue.tryPush(value) && !park([&]
+                                               { return queue.tryPush(value); }))
+                return false;
+            wake();
+            return true;
+        }
+
+        template <typename T>
+        bool pop(BoundedQueue<T> &queue, T &value)
+        {
+            if (!queue.tryPop(value) && !park([&]
+                                              { return queue.tryPop(value); }))
+                return false;
+            wake();
+            return true;
+        }
+
+        // Call after every stage has joined
+        void rethrow()
+        {
+            if (error)
+                rethrow_exception(error);
+        }
+    };
+}
+
+#endif // BOUNDED_QUEUE_HPP
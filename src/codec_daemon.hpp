@@ -0,0 +1,580 @@
+#ifndef CODEC_DAEMON_HPP
+#define CODEC_DAEMON_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+#include "framed_codec.hpp"
+#include "parallel_codec.hpp"
+#include "codec_metrics.hpp"
+
+using namespace std;
+
+// Wire format over a Unix domain stream socket, integers big-endian:
+//   request:  op (1) | alphabet (1) | rounds (2) | length (4) | payload
+//   response: status (1) | reserved (3) | length (4) | result, or the error text
+// Requests on one connection are answered in order and may be pipelined.
+// Letters payloads are normalized like CLI input (spaces dropped, uppercased, letters and
+// '.' only). Binary payloads have no terminator to stop at, so they are decoded through
+// frames: E accepts them, D refuses them, F/U round-trip them exactly.
+namespace diamond
+{
+    namespace wire
+    {
+        enum Op : uint8_t
+        {
+            Encode = 'E',  // diamond::encode
+            Decode = 'D',  // diamond::decode, stopping after '.'; letters only
+            Frame = 'F',   // diamond::frame
+            Unframe = 'U', // diamond::unframe (rounds unused)
+            Stats = 'M',   // metrics as Prometheus text, or JSON when the payload is "json"
+        };
+
+        enum Status : uint8_t
+        {
+            Ok = 0,
+            Failed = 1
+        };
+
+        constexpr size_t HEADER_SIZE = 8;
+        constexpr uint32_t MAX_PAYLOAD = 1u << 24;
+
+        inline void putHeader(char *out, uint8_t first, uint8_t second, uint16_t rounds, uint32_t length)
+        {
+            out[0] = static_cast<char>(first);
+            out[1] = static_cast<char>(second);
+            out[2] = static_cast<char>(rounds >> 8);
+            out[3] = static_cast<char>(rounds);
+            for (int i = 0; i < 4; i++)
+                out[4 + i] = static_cast<char>(length >> (24 - 8 * i));
+        }
+
+        inline uint16_t getRounds(const char *in)
+        {
+            return static_cast<uint16_t>(static_cast<uint8_t>(in[2]) << 8 | static_cast<uint8_t>(in[3]));
+        }
+
+        inline uint32_t getLength(const char *in)
+        {
+            uint32_t length = 0;
+            for (int i = 0; i < 4; i++)
+                length = length << 8 | static_cast<uint8_t>(in[4 + i]);
+            return length;
+        }
+
+        inline CustomException systemError(const string &what)
+        {
+            return CustomException(what + ": " + strerror(errno), true);
+        }
+
+        inline sockaddr_un address(const string &path)
+        {
+            sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path))
+                throw CustomException("Socket path is too long: " + path, true);
+            memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            return addr;
+        }
+    }
+
+    // Long-running codec service: one epoll loop accepts connections and reads requests;
+    // every request that arrived in the same wakeup is run as one batch on the codec workers.
+    // A client that sends faster than it reads is throttled: past OUTPUT_HIGH_WATER unsent
+    // bytes its connection is neither read nor parsed until the output drains below
+    // OUTPUT_LOW_WATER, so a peer that never reads cannot grow the daemon without bound.
+    class CodecServer
+    {
+    private:
+        static const uint64_t LISTEN_ID = 0;
+        static const uint64_t WAKE_ID = 1;
+        static const size_t OUTPUT_HIGH_WATER = 4 << 20;
+        static const size_t OUTPUT_LOW_WATER = 1 << 20;
+        static const size_t READ_AHEAD = 1 << 20; // input buffered beyond a whole request
+        static const size_t MAX_IN_FLIGHT = 64;   // requests taken from one connection per batch
+        static const int ACCEPT_RETRY_MS = 100;   // accepting again after running out of descriptors
+
+        struct Connection
+        {
+            int fd = -1;
+            string in;
+            string out;
+            size_t out_position = 0;
+            uint32_t events = EPOLLIN; // current epoll registration
+            bool peer_closed = false;  // nothing more to read; close once output is drained
+            bool paused = false;       // too much unsent output: neither read nor parsed
+        };
+
+        struct Request
+        {
+            uint64_t connection;
+            uint8_t op;
+            Alphabet alphabet;
+            int rounds;
+            string payload;
+            string result;
+            bool failed = false;
+        };
+
+        string path;
+        int listen_fd = -1;
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        ParallelCodec codec;
+        map<uint64_t, Connection> connections; // keyed by id, so a reused fd never gets a stale reply
+        uint64_t next_id = 2;
+        atomic<bool> stopping{false};
+        bool accepting = true; // listen socket is in the epoll set
+        size_t served = 0;
+
+        void watch(int fd, uint64_t id, uint32_t events, int operation)
+        {
+            epoll_event event;
+            event.events = events;
+            event.data.u64 = id;
+            if (epoll_ctl(epoll_fd, operation, fd, &event) < 0)
+                throw wire::systemError("Cannot watch socket");
+        }
+
+        // The listen socket is level-triggered, so while no descriptor is left for a new
+        // connection it leaves the epoll set; a closed connection or a timeout brings it back
+        void setAccepting(bool on)
+        {
+            if (on == accepting)
+                return;
+            accepting = on;
+            watch(listen_fd, LISTEN_ID, on ? EPOLLIN : 0, EPOLL_CTL_MOD);
+        }
+
+        void acceptAll()
+        {
+            while (true)
+            {
+                int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0)
+                {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue; // a connection that went away before we got to it
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return;
+                    if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                    {
+                        setAccepting(false);
+                        return;
+                    }
+                    throw wire::systemError("Cannot accept connection");
+                }
+
+                uint64_t id = next_id++;
+                connections[id].fd = fd;
+                watch(fd, id, EPOLLIN, EPOLL_CTL_ADD);
+            }
+        }
+
+        void closeConnection(uint64_t id)
+        {
+            auto it = connections.find(id);
+            if (it == connections.end())
+                return;
+            close(it->second.fd); // also removes it from the epoll set
+            connections.erase(it);
+            setAccepting(true);
+        }
+
+        // True when the input starts with a whole request, or with a length that is never valid
+        static bool hasRequest(const Connection &conn)
+        {
+            if (conn.in.size() < wire::HEADER_SIZE)
+                return false;
+            uint32_t length = wire::getLength(conn.in.data());
+            return length > wire::MAX_PAYLOAD || conn.in.size() >= wire::HEADER_SIZE + length;
+        }
+
+        // Read what is available, stopping early once a whole request and READ_AHEAD bytes are buffered
+        void readFrom(uint64_t id)
+        {
+            Connection &conn = connections[id];
+            char buffer[1 << 16];
+            while (conn.in.size() < READ_AHEAD || !hasRequest(conn))
+            {
+                ssize_t got = recv(conn.fd, buffer, sizeof(buffer), 0);
+                if (got > 0)
+                {
+                    conn.in.append(buffer, static_cast<size_t>(got));
+                    continue;
+                }
+                if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                    conn.peer_closed = true;
+                if (got == 0 || errno != EINTR)
+                    break;
+            }
+        }
+
+        // Cut up to MAX_IN_FLIGHT complete requests off the input
+        void takeRequests(uint64_t id, vector<Request> &batch)
+        {
+            Connection &conn = connections[id];
+            if (conn.paused)
+                return;
+
+            size_t position = 0;
+            for (size_t taken = 0; taken < MAX_IN_FLIGHT && conn.in.size() - position >= wire::HEADER_SIZE; taken++)
+            {
+                const char *header = conn.in.data() + position;
+                uint32_t length = wire::getLength(header);
+                if (length > wire::MAX_PAYLOAD)
+                {
+                    conn.peer_closed = true; // cannot resynchronize after a bad length
+                    position = conn.in.size();
+                    break;
+                }
+                if (conn.in.size() - position < wire::HEADER_SIZE + length)
+                    break;
+
+                Request request;
+                request.connection = id;
+                request.op = static_cast<uint8_t>(header[0]);
+                request.alphabet = header[1] ? Alphabet::Bytes : Alphabet::Letters;
+                request.rounds = wire::getRounds(header);
+                request.payload.assign(header + wire::HEADER_SIZE, length);
+                batch.push_back(move(request));
+                position += wire::HEADER_SIZE + length;
+            }
+            conn.in.erase(0, position);
+        }
+
+        static void handle(Request &request)
+        {
+            try
+            {
+                bool letters = request.alphabet == Alphabet::Letters;
+                if (letters && (request.op == wire::Encode || request.op == wire::Decode || request.op == wire::Frame))
+                    request.payload = normalize(request.payload);
+
+                switch (request.op)
+                {
+                case wire::Encode:
+                    encode(request.payload, request.rounds, request.result, request.alphabet);
+                    break;
+                case wire::Decode:
+                    if (!letters)
+                        throw CustomException("Binary payloads must be framed: use F and U instead of D", true);
+                    decode(request.payload, request.rounds, request.result);
+                    break;
+                case wire::Frame:
+                    request.result = frame(request.payload, request.rounds, request.alphabet);
+                    break;
+                case wire::Unframe:
+                    request.result = unframe(request.payload);
+                    break;
+                case wire::Stats:
+                    request.result = request.payload == "json" ? Metrics::toJson() : Metrics::toPrometheus();
+                    break;
+                default:
+                    throw CustomException("Unknown operation", true);
+                }
+            }
+            catch (const CustomException &e)
+            {
+                request.failed = true;
+                request.result = e.what();
+            }
+            catch (const exception &e)
+            {
+                // e.g. bad_alloc on a worker; the connection gets an error frame, the daemon lives on
+                request.failed = true;
+                request.result = string("Internal error: ") + e.what();
+            }
+        }
+
+        void respond(Request &request)
+        {
+            auto it = connections.find(request.connection);
+            if (it == connections.end())
+                return;
+
+            char header[wire::HEADER_SIZE];
+            wire::putHeader(header, request.failed ? wire::Failed : wire::Ok, 0, 0, static_cast<uint32_t>(request.result.size()));
+            it->second.out.append(header, sizeof(header));
+            it->second.out.append(request.result);
+            served++;
+        }
+
+        // Write pending output. EPOLLOUT stays registered only while the socket is full, and
+        // EPOLLIN is dropped once the peer closed: end of file would report ready forever.
+        void flush(uint64_t id)
+        {
+            auto it = connections.find(id);
+            if (it == connections.end())
+                return;
+            Connection &conn = it->second;
+
+            while (conn.out_position < conn.out.size())
+            {
+                ssize_t sent = send(conn.fd, conn.out.data() + conn.out_position, conn.out.size() - conn.out_position, MSG_NOSIGNAL);
+                if (sent > 0)
+                    conn.out_position += static_cast<size_t>(sent);
+                else if (errno == EINTR)
+                    continue;
+                else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                else
+                {
+                    closeConnection(id);
+                    return;
+                }
+            }
+
+            bool pending = conn.out_position < conn.out.size();
+            if (!pending)
+            {
+                conn.out.clear();
+                conn.out_position = 0;
+                if (conn.peer_closed && !hasRequest(conn))
+                {
+                    closeConnection(id);
+                    return;
+                }
+            }
+            else if (conn.out_position >= OUTPUT_LOW_WATER)
+            {
+                conn.out.erase(0, conn.out_position); // a slow reader never lets out empty
+                conn.out_position = 0;
+            }
+
+            size_t unsent = conn.out.size() - conn.out_position;
+            if (conn.paused ? unsent < OUTPUT_LOW_WATER : unsent > OUTPUT_HIGH_WATER)
+                conn.paused = !conn.paused;
+
+            uint32_t events = (conn.peer_closed || conn.paused ? 0 : EPOLLIN) | (pending ? EPOLLOUT : 0);
+            if (events != conn.events)
+            {
+                conn.events = events;
+                watch(conn.fd, id, events, EPOLL_CTL_MOD);
+            }
+        }
+
+    public:
+        CodecServer(const string &socketPath, int threads) : path(socketPath), codec(threads)
+        {
+            sockaddr_un addr = wire::address(path);
+
+            listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd < 0)
+                throw wire::systemError("Cannot create socket");
+
+            unlink(path.c_str()); // stale socket from an earlier run
+            if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(listen_fd, SOMAXCONN) < 0)
+            {
+                CustomException error = wire::systemError("Cannot listen on '" + path + "'");
+                close(listen_fd);
+                throw error;
+            }
+
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (epoll_fd < 0 || wake_fd < 0)
+            {
+                CustomException error = wire::systemError("Cannot create event loop");
+                close(listen_fd);
+                throw error;
+            }
+            watch(listen_fd, LISTEN_ID, EPOLLIN, EPOLL_CTL_ADD);
+            watch(wake_fd, WAKE_ID, EPOLLIN, EPOLL_CTL_ADD);
+        }
+
+        CodecServer(const CodecServer &) = delete;
+        CodecServer &operator=(const CodecServer &) = delete;
+
+        ~CodecServer()
+        {
+            for (auto &entry : connections)
+                close(entry.second.fd);
+            close(wake_fd);
+            close(epoll_fd);
+            close(listen_fd);
+            unlink(path.c_str());
+        }
+
+        // Serve until stop() is called
+        void run()
+        {
+            vector<epoll_event> events(256);
+            vector<Request> batch;
+            vector<uint64_t> touched;
+            vector<uint64_t> backlog; // connections with whole requests left over from the last batch
+
+            while (!stopping)
+            {
+                int timeout = !backlog.empty() ? 0 : accepting ? -1 : ACCEPT_RETRY_MS;
+                int ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout);
+                if (ready < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    throw wire::systemError("Event loop failed");
+                }
+                if (ready == 0)
+                    setAccepting(true); // descriptors may have been freed elsewhere
+
+                batch.clear();
+                touched.swap(backlog);
+                backlog.clear();
+                for (int i = 0; i < ready; i++)
+                {
+                    uint64_t id = events[i].data.u64;
+                    if (id == LISTEN_ID)
+                        acceptAll();
+                    else if (id == WAKE_ID)
+                    {
+                        uint64_t count;
+                        ssize_t ignored = read(wake_fd, &count, sizeof(count));
+                        (void)ignored;
+                    }
+                    else if (connections.count(id))
+                    {
+                        const Connection &conn = connections[id];
+                        if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !conn.peer_closed && !conn.paused)
+                            readFrom(id);
+                        touched.push_back(id);
+                    }
+                }
+                sort(touched.begin(), touched.end());
+                touched.erase(unique(touched.begin(), touched.end()), touched.end());
+                for (uint64_t id : touched)
+                    if (connections.count(id))
+                        takeRequests(id, batch);
+
+                // Everything that arrived together goes through the codec as one batch
+                codec.forEach(batch.size(), [&](size_t i)
+                              { handle(batch[i]); });
+                for (Request &request : batch)
+                    respond(request);
+                for (uint64_t id : touched)
+                {
+                    flush(id);
+                    auto it = connections.find(id);
+                    if (it != connections.end() && !it->second.paused && hasRequest(it->second))
+                        backlog.push_back(id);
+                }
+            }
+        }
+
+        // Safe from other threads and from signal handlers
+        void stop()
+        {
+            stopping = true;
+            uint64_t one = 1;
+            ssize_t ignored = write(wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+
+        size_t getServedCount() const { return served; }
+        const string &getPath() const { return path; }
+    };
+
+    // Blocking client for CodecServer. send() and receive() may be split to pipeline requests.
+    class CodecClient
+    {
+    private:
+        int fd = -1;
+
+        void writeAll(const char *data, size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent <= 0)
+                    throw wire::systemError("Cannot send request");
+                data += sent;
+                size -= static_cast<size_t>(sent);
+            }
+        }
+
+        void readAll(char *data, size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t got = recv(fd, data, size, 0);
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got < 0)
+                    throw wire::systemError("Cannot read response");
+                if (got == 0)
+                    throw CustomException("Server closed the connection", true);
+                data += got;
+                size -= static_cast<size_t>(got);
+            }
+        }
+
+    public:
+        explicit CodecClient(const string &socketPath)
+        {
+            sockaddr_un addr = wire::address(socketPath);
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                throw wire::systemError("Cannot create socket");
+            if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+            {
+                CustomException error = wire::systemError("Cannot connect to '" + socketPath + "'");
+                close(fd);
+                throw error;
+            }
+        }
+
+        CodecClient(const CodecClient &) = delete;
+        CodecClient &operator=(const CodecClient &) = delete;
+
+        ~CodecClient() { close(fd); }
+
+        void send(uint8_t op, int rounds, string_view payload, Alphabet alphabet = Alphabet::Letters)
+        {
+            if (rounds < 0 || rounds > 0xFFFF || payload.size() > wire::MAX_PAYLOAD)
+                throw CustomException("Request does not fit the wire format", true);
+
+            char header[wire::HEADER_SIZE];
+            wire::putHeader(header, op, alphabet == Alphabet::Bytes, static_cast<uint16_t>(rounds), static_cast<uint32_t>(payload.size()));
+            writeAll(header, sizeof(header));
+            writeAll(payload.data(), payload.size());
+        }
+
+        // Next response; a failed request throws with the server's error text
+        string receive()
+        {
+            char header[wire::HEADER_SIZE];
+            readAll(header, sizeof(header));
+            string result(wire::getLength(header), ' ');
+            readAll(&result[0], result.size());
+            if (static_cast<uint8_t>(header[0]) != wire::Ok)
+                throw CustomException(result); // already formatted by the server
+            return result;
+        }
+
+        string call(uint8_t op, int rounds, string_view payload, Alphabet alphabet = Alphabet::Letters)
+        {
+            send(op, rounds, payload, alphabet);
+            return receive();
+        }
+
+        string encode(string_view msg, int rounds, Alphabet alphabet = Alphabet::Letters) { return call(wire::Encode, rounds, msg, alphabet); }
+        string decode(string_view cipher, int rounds, Alphabet alphabet = Alphabet::Letters) { return call(wire::Decode, rounds, cipher, alphabet); }
+    };
+}
+
+#endif // CODEC_DAEMON_HPP
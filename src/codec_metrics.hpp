@@ -0,0 +1,320 @@
+#ifndef CODEC_METRICS_HPP
+#define CODEC_METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+namespace diamond
+{
+    // Counters and latency histograms for the codec hot paths.
+    // Recording is off until enable() is called; when off each hook is one relaxed load.
+    // Every thread writes only its own shard (relaxed load + store, no locked instructions);
+    // readers sum the shards, and a finished thread's shard is folded into a retired total.
+    class Metrics
+    {
+    public:
+        enum Counter
+        {
+            EncodeCalls,
+            DecodeCalls,
+            BytesIn,
+            BytesOut,
+            OutputCells,   // ciphertext cells produced
+            FillerCells,   // of which padding
+            BufferGrowths, // output buffers that had to reallocate
+            MapBuilds,     // round maps and diamond tables built on a cache miss
+            TasksRun,      // scheduler tasks: whole blocks and row bands
+            TasksStolen,   // of which run by a worker that stole them
+            WorkerBusyNs,  // worker time spent running tasks
+            WorkerWallNs,  // batch time times the number of workers
+            COUNTER_COUNT
+        };
+
+        enum Op
+        {
+            Encode,
+            Decode,
+            OP_COUNT
+        };
+
+        static const int GRID_SLOTS = 257;   // sizes 0..255, the last slot collects larger grids
+        static const int ROUND_SLOTS = 9;    // rounds 1..8, the last slot collects more
+        static const int LATENCY_BUCKETS = 40; // bucket b: [2^b, 2^(b+1)) nanoseconds
+
+        struct Histogram
+        {
+            uint64_t buckets[LATENCY_BUCKETS] = {};
+            uint64_t count = 0;
+            uint64_t sum = 0; // nanoseconds
+        };
+
+        // Plain totals, as returned by snapshot()
+        struct Snapshot
+        {
+            uint64_t counters[COUNTER_COUNT] = {};
+            uint64_t grid_sizes[GRID_SLOTS] = {};
+            Histogram latency[OP_COUNT][ROUND_SLOTS];
+        };
+
+    private:
+        struct AtomicHistogram
+        {
+            atomic<uint64_t> buckets[LATENCY_BUCKETS] = {};
+            atomic<uint64_t> count{0};
+            atomic<uint64_t> sum{0};
+        };
+
+        struct Shard
+        {
+            atomic<uint64_t> counters[COUNTER_COUNT] = {};
+            atomic<uint64_t> grid_sizes[GRID_SLOTS] = {};
+            AtomicHistogram latency[OP_COUNT][ROUND_SLOTS];
+        };
+
+        struct Registry
+        {
+            mutex lock;
+            vector<Shard *> live;
+            Snapshot retired;
+        };
+
+        // Single writer per shard, so a plain read-modify-write is enough
+        static void bump(atomic<uint64_t> &value, uint64_t amount)
+        {
+            value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+        }
+
+        static atomic<bool> &flag()
+        {
+            static atomic<bool> on{false};
+            return on;
+        }
+
+        static Registry &registry()
+        {
+            static Registry *instance = new Registry(); // outlives thread_local shards at exit
+            return *instance;
+        }
+
+        static void addShard(Snapshot &total, const Shard &shard)
+        {
+            for (int c = 0; c < COUNTER_COUNT; c++)
+                total.counters[c] += shard.counters[c].load(memory_order_relaxed);
+            for (int s = 0; s < GRID_SLOTS; s++)
+                total.grid_sizes[s] += shard.grid_sizes[s].load(memory_order_relaxed);
+            for (int op = 0; op < OP_COUNT; op++)
+                for (int r = 0; r < ROUND_SLOTS; r++)
+                {
+                    const AtomicHistogram &from = shard.latency[op][r];
+                    Histogram &to = total.latency[op][r];
+                    for (int b = 0; b < LATENCY_BUCKETS; b++)
+                        to.buckets[b] += from.buckets[b].load(memory_order_relaxed);
+                    to.count += from.count.load(memory_order_relaxed);
+                    to.sum += from.sum.load(memory_order_relaxed);
+                }
+        }
+
+        // Registers on first use, folds into the retired total when the thread exits
+        struct ShardHandle
+        {
+            Shard shard;
+
+            ShardHandle()
+            {
+                Registry &reg = registry();
+                lock_guard<mutex> guard(reg.lock);
+                reg.live.push_back(&shard);
+            }
+
+            ~ShardHandle()
+            {
+                Registry &reg = registry();
+                lock_guard<mutex> guard(reg.lock);
+                addShard(reg.retired, shard);
+                reg.live.erase(find(reg.live.begin(), reg.live.end(), &shard));
+            }
+        };
+
+        static Shard &local()
+        {
+            thread_local ShardHandle handle;
+            return handle.shard;
+        }
+
+        static const char *counterName(int counter)
+        {
+            static const char *names[COUNTER_COUNT] = {"encode_calls", "decode_calls", "bytes_in", "bytes_out",
+                                                       "output_cells", "filler_cells", "buffer_growths", "map_builds",
+                                                       "tasks_run", "tasks_stolen", "worker_busy_ns", "worker_wall_ns"};
+            return names[counter];
+        }
+
+        static const char *opName(int op) { return op == Encode ? "encode" : "decode"; }
+
+        static string roundLabel(int slot) { return slot == ROUND_SLOTS - 1 ? to_string(slot) + "+" : to_string(slot); }
+
+        static string gridLabel(int slot) { return slot == GRID_SLOTS - 1 ? to_string(slot) + "+" : to_string(slot); }
+
+    public:
+        static void enable(bool on = true) { flag().store(on, memory_order_relaxed); }
+        static bool enabled() { return flag().load(memory_order_relaxed); }
+
+        static void add(Counter counter, uint64_t amount = 1)
+        {
+            if (enabled())
+                bump(local().counters[counter], amount);
+        }
+
+        static void gridSize(int size)
+        {
+            if (enabled())
+                bump(local().grid_sizes[min(max(size, 0), GRID_SLOTS - 1)], 1);
+        }
+
+        static void latency(Op op, int rounds, uint64_t nanoseconds)
+        {
+            AtomicHistogram &histogram = local().latency[op][min(max(rounds, 1), ROUND_SLOTS - 1)];
+            int bucket = 0;
+            while (bucket < LATENCY_BUCKETS - 1 && (nanoseconds >> (bucket + 1)) != 0)
+                bucket++;
+            bump(histogram.buckets[bucket], 1);
+            bump(histogram.count, 1);
+            bump(histogram.sum, nanoseconds);
+        }
+
+        // Totals over every thread, live and finished
+        static Snapshot snapshot()
+        {
+            Registry &reg = registry();
+            lock_guard<mutex> guard(reg.lock);
+            Snapshot total = reg.retired;
+            for (const Shard *shard : reg.live)
+                addShard(total, *shard);
+            return total;
+        }
+
+        static string toJson()
+        {
+            Snapshot snap = snapshot();
+            ostringstream out;
+            out << "{\"counters\":{";
+            for (int c = 0; c < COUNTER_COUNT; c++)
+                out << (c ? "," : "") << '"' << counterName(c) << "\":" << snap.counters[c];
+
+            double cells = static_cast<double>(snap.counters[OutputCells]);
+            out << "},\"filler_ratio\":" << (cells > 0 ? snap.counters[FillerCells] / cells : 0.0);
+
+            double wall = static_cast<double>(snap.counters[WorkerWallNs]);
+            out << ",\"utilization\":" << (wall > 0 ? snap.counters[WorkerBusyNs] / wall : 0.0);
+
+            out << ",\"grid_sizes\":{";
+            bool first = true;
+            for (int s = 0; s < GRID_SLOTS; s++)
+                if (snap.grid_sizes[s] != 0)
+                {
+                    out << (first ? "" : ",") << '"' << gridLabel(s) << "\":" << snap.grid_sizes[s];
+                    first = false;
+                }
+
+            out << "},\"latency_ns\":{";
+            for (int op = 0; op < OP_COUNT; op++)
+            {
+                out << (op ? "," : "") << '"' << opName(op) << "\":{";
+                first = true;
+                for (int r = 1; r < ROUND_SLOTS; r++)
+                {
+                    const Histogram &h = snap.latency[op][r];
+                    if (h.count == 0)
+                        continue;
+                    out << (first ? "" : ",") << '"' << roundLabel(r) << "\":{\"count\":" << h.count << ",\"sum\":" << h.sum << ",\"buckets\":{";
+                    bool first_bucket = true;
+                    for (int b = 0; b < LATENCY_BUCKETS; b++)
+                        if (h.buckets[b] != 0)
+                        {
+                            out << (first_bucket ? "" : ",") << '"' << (1ULL << (b + 1)) << "\":" << h.buckets[b];
+                            first_bucket = false;
+                        }
+                    out << "}}";
+                    first = false;
+                }
+                out << "}";
+            }
+            out << "}}";
+            return out.str();
+        }
+
+        // Prometheus text exposition format
+        static string toPrometheus()
+        {
+            Snapshot snap = snapshot();
+            ostringstream out;
+            for (int c = 0; c < COUNTER_COUNT; c++)
+                out << "# TYPE diamond_" << counterName(c) << "_total counter\n"
+                    << "diamond_" << counterName(c) << "_total " << snap.counters[c] << "\n";
+
+            // Counters only grow and exited threads fold into the retired total, so a grid size
+            // that was ever used keeps its series in every later scrape
+            out << "# TYPE diamond_grid_size_total counter\n";
+            for (int s = 0; s < GRID_SLOTS; s++)
+                if (snap.grid_sizes[s] != 0)
+                    out << "diamond_grid_size_total{size=\"" << gridLabel(s) << "\"} " << snap.grid_sizes[s] << "\n";
+
+            for (int op = 0; op < OP_COUNT; op++)
+            {
+                string name = string("diamond_") + opName(op) + "_seconds";
+                out << "# TYPE " << name << " histogram\n";
+                for (int r = 1; r < ROUND_SLOTS; r++)
+                {
+                    const Histogram &h = snap.latency[op][r];
+                    if (h.count == 0)
+                        continue;
+                    string label = "rounds=\"" + roundLabel(r) + "\"";
+                    // The full fixed ladder every time, so bucket series never come and go
+                    uint64_t cumulative = 0;
+                    for (int b = 0; b < LATENCY_BUCKETS; b++)
+                    {
+                        cumulative += h.buckets[b];
+                        out << name << "_bucket{" << label << ",le=\"" << (1ULL << (b + 1)) * 1e-9 << "\"} " << cumulative << "\n";
+                    }
+                    out << name << "_bucket{" << label << ",le=\"+Inf\"} " << h.count << "\n"
+                        << name << "_sum{" << label << "} " << h.sum * 1e-9 << "\n"
+                        << name << "_count{" << label << "} " << h.count << "\n";
+                }
+            }
+            return out.str();
+        }
+    };
+
+    // Times a scope into the latency histogram; does nothing while metrics are off
+    class MetricsTimer
+    {
+    private:
+        Metrics::Op op;
+        int rounds;
+        bool active;
+        chrono::steady_clock::time_point start;
+
+    public:
+        MetricsTimer(Metrics::Op operation, int roundCount) : op(operation), rounds(roundCount), active(Metrics::enabled())
+        {
+            if (active)
+                start = chrono::steady_clock::now();
+        }
+
+        ~MetricsTimer()
+        {
+            if (active)
+                Metrics::latency(op, rounds, static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()));
+        }
+    };
+}
+
+#endif // CODEC_METRICS_HPP
@@ -0,0 +1,54 @@
+#ifndef CUSTOM_EXCEPTION_HPP
+#define CUSTOM_EXCEPTION_HPP
+
+#include <exception>
+#include <string>
+
+using namespace std;
+
+class CustomException : public exception
+{
+public:
+    // identify kinds or error
+    enum class Type
+    {
+        Generic,
+        InvalidGridSize,
+        InvalidInput
+    };
+
+private:
+    string error_message;
+    Type type_;
+
+public:
+    // Constructor for generic message
+    explicit CustomException(const string &message)
+        : error_message(message), type_(Type::Generic) {}
+
+    // Constructor for InvalidGridSizeException
+    explicit CustomException(int gridSize)
+        : type_(Type::InvalidGridSize)
+    {
+        error_message = "Invalid grid size: " + to_string(gridSize);
+    }
+
+    // Constructor for InvalidInputException
+    explicit CustomException(const string &message, bool isInputError)
+        : type_(Type::InvalidInput)
+    {
+        error_message = "Invalid input: " + message;
+    }
+
+    virtual const char *what() const noexcept override
+    {
+        return error_message.c_str();
+    }
+
+    Type getType() const
+    {
+        return type_;
+    }
+};
+
+#endif // CUSTOM_EXCEPTION_HPP
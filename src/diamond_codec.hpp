@@ -0,0 +1,333 @@
+#ifndef DIAMOND_CODEC_HPP
+#define DIAMOND_CODEC_HPP
+
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include "custom_exception.hpp"
+#include "diamond_table.hpp"
+#include "fixed_codec.hpp"
+#include "filler_rng.hpp"
+#include "codec_metrics.hpp"
+
+using namespace std;
+
+// Headless encoder/decoder: no console I/O, no sleeps, no screen clears.
+// Encryption and Decryption in the menu program are thin wrappers around this.
+namespace diamond
+{
+    // Character set of payload and filler
+    enum class Alphabet
+    {
+        Letters, // A-Z and '.', filler A-Z (the default)
+        Bytes    // any byte, filler any byte except '.'
+    };
+
+    // Ciphertext layout: FULL_GRID emits every cell of every round's grid; any count
+    // n >= 0 selects the compact layout, which emits only the diamond cells plus at most
+    // n filler cells per round (see RoundMap). Both sides must agree on the layout.
+    constexpr int FULL_GRID = RoundMap::FULL_GRID;
+
+    // Letters and full stops only
+    inline bool isValidMessage(string_view input)
+    {
+        if (input.empty())
+            return false;
+        for (char c : input)
+            if (!(isalpha(static_cast<unsigned char>(c)) || c == '.'))
+                return false;
+        return true;
+    }
+
+    // Remove spaces, validate and convert to uppercase
+    inline string normalize(string_view input)
+    {
+        string result;
+        result.reserve(input.size());
+        for (char c : input)
+            if (c != ' ')
+                result += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+
+        if (!isValidMessage(result))
+            throw CustomException("Input must be non-empty and contain only letters (A-Z or a-z).", true);
+        return result;
+    }
+
+    // Grid size the encoder picks for a message length
+    inline int gridSizeFor(int length) { return RoundMap::encodeGridSize(length); }
+
+    // Grid size the decoder picks for a ciphertext length
+    inline int decodeGridSize(int length) { return RoundMap::decodeGridSize(length); }
+
+    // Random filler letter for cells outside the message
+    inline char fillerChar() { return FillerRng::local().letter(); }
+
+    // Make this thread's filler reproducible
+    inline void seedFiller(uint64_t seed) { FillerRng::local().seed(seed); }
+
+    // Reproducible filler for one unit of work, whichever thread runs it
+    inline void seedFiller(uint64_t seed, uint64_t stream) { FillerRng::local().seed(seed, stream); }
+
+    // One round: place the message into the diamond of a row-major size * size grid.
+    // Every cell is written; cells the message does not reach become ' '.
+    inline void scatter(string_view msg, int size, char *cells)
+    {
+        MetricsTimer timer(Metrics::Encode, 1);
+        if (Metrics::enabled())
+        {
+            Metrics::add(Metrics::EncodeCalls);
+            Metrics::add(Metrics::BytesIn, msg.size());
+            Metrics::add(Metrics::BytesOut, size * size);
+            Metrics::add(Metrics::OutputCells, size * size);
+            Metrics::add(Metrics::FillerCells, size * size - msg.size());
+            Metrics::gridSize(size);
+        }
+
+        const DiamondTable &table = DiamondTable::forSize(size);
+        if (static_cast<int>(msg.size()) > table.getDiamondSize())
+            throw CustomException(size);
+
+        // Unrolled compile-time tables beat every kernel except the single vpermi2b pass
+        if (hasFixedCodec(size) && table.getEncodePlan().getKernel() != Kernel::Permute)
+        {
+            fixedScatter(msg, size, cells);
+            return;
+        }
+
+        // Diamond-ordered source padded with blanks, plus the blank read by outside cells
+        thread_local string source;
+        source.assign(msg.data(), msg.size());
+        source.resize(table.getDiamondSize() + 1, ' ');
+        table.getEncodePlan().apply(source.data(), cells);
+    }
+
+    // Metrics for one decode call
+    inline void recordDecode(size_t in, size_t out)
+    {
+        if (!Metrics::enabled())
+            return;
+        Metrics::add(Metrics::DecodeCalls);
+        Metrics::add(Metrics::BytesIn, in);
+        Metrics::add(Metrics::BytesOut, out);
+    }
+
+    // Output buffer about to grow past its capacity
+    inline void recordGrowth(const string &buffer, size_t size)
+    {
+        if (size > buffer.capacity())
+            Metrics::add(Metrics::BufferGrowths);
+    }
+
+    // Number of characters kept by stopAtDot: up to and including the first '.'
+    inline size_t keptLength(const char *text, size_t length, bool stopAtDot)
+    {
+        if (!stopAtDot)
+            return length;
+        const void *dot = memchr(text, '.', length);
+        return dot == nullptr ? length : static_cast<const char *>(dot) - text + 1;
+    }
+
+    // One round into a caller buffer of size * size / 2 + 1 characters; returns the count kept
+    // (cells are the ciphertext itself, i.e. the decoder's column-major grid)
+    inline size_t gatherInto(const char *cells, int size, bool stopAtDot, char *out)
+    {
+        MetricsTimer timer(Metrics::Decode, 1);
+        size_t length = size * size / 2 + 1;
+        if (hasFixedCodec(size))
+            fixedGather(cells, size, out);
+        else
+            DiamondTable::forSize(size).getDecodePlan().apply(cells, out);
+
+        size_t kept = keptLength(out, length, stopAtDot);
+        recordDecode(size * size, kept);
+        return kept;
+    }
+
+    // One round: append the diamond read out of the grid, optionally stopping after the first '.'
+    inline void gather(const char *cells, int size, bool stopAtDot, string &out)
+    {
+        size_t start = out.size();
+        recordGrowth(out, start + size * size / 2 + 1);
+        out.resize(start + size * size / 2 + 1);
+        out.resize(start + gatherInto(cells, size, stopAtDot, &out[start]));
+    }
+
+    // Ciphertext length for a message length after a number of rounds
+    inline int encodedLength(int length, int rounds, int filler = FULL_GRID) { return RoundMap::encoding(length, rounds, filler)->getOutputLength(); }
+
+    // Encrypt with an encoding map already resolved for msg.size() into a caller buffer of
+    // map.getOutputLength() characters
+    inline void encodeInto(const RoundMap &map, string_view msg, char *out, Alphabet alphabet = Alphabet::Letters)
+    {
+        MetricsTimer timer(Metrics::Encode, static_cast<int>(map.getGridSizes().size()));
+        if (Metrics::enabled())
+        {
+            Metrics::add(Metrics::EncodeCalls);
+            Metrics::add(Metrics::BytesIn, msg.size());
+            Metrics::add(Metrics::BytesOut, map.getOutputLength());
+            Metrics::add(Metrics::OutputCells, map.getOutputLength());
+            Metrics::add(Metrics::FillerCells, map.getFillerCount());
+            for (int size : map.getGridSizes())
+                Metrics::gridSize(size);
+        }
+
+        if (!msg.empty())
+            map.getPlan().apply(msg.data(), out);
+        FillerRng &rng = FillerRng::local();
+        for (const pair<int, int> &run : map.getFillerRuns())
+        {
+            if (alphabet == Alphabet::Bytes)
+                rng.fillBytes(out + run.first, run.second);
+            else
+                rng.fillLetters(out + run.first, run.second);
+        }
+    }
+
+    // Encrypt into a caller buffer of encodedLength(msg.size(), rounds, filler) characters
+    inline void encodeInto(string_view msg, int rounds, char *out, Alphabet alphabet = Alphabet::Letters, int filler = FULL_GRID)
+    {
+        encodeInto(*RoundMap::encoding(static_cast<int>(msg.size()), rounds, filler), msg, out, alphabet);
+    }
+
+    // Checked form for a caller buffer of capacity characters; returns the length written
+    inline size_t encodeInto(string_view msg, int rounds, char *out, size_t capacity, Alphabet alphabet = Alphabet::Letters, int filler = FULL_GRID)
+    {
+        shared_ptr<const RoundMap> map = RoundMap::encoding(static_cast<int>(msg.size()), rounds, filler);
+        size_t length = map->getOutputLength();
+        if (length > capacity)
+            throw CustomException("Output buffer too small for the ciphertext", true);
+        encodeInto(*map, msg, out, alphabet);
+        return length;
+    }
+
+    // Encrypt into out, reusing its capacity; out must not alias msg
+    inline void encode(string_view msg, int rounds, string &out, Alphabet alphabet = Alphabet::Letters, int filler = FULL_GRID)
+    {
+        shared_ptr<const RoundMap> map = RoundMap::encoding(static_cast<int>(msg.size()), rounds, filler);
+        size_t length = map->getOutputLength();
+        recordGrowth(out, length);
+        out.resize(length);
+        encodeInto(*map, msg, &out[0], alphabet);
+    }
+
+    // Encrypt a message over a number of rounds, filling unused cells with random letters
+    // (or random bytes for Alphabet::Bytes)
+    inline string encode(string_view msg, int rounds, Alphabet alphabet = Alphabet::Letters, int filler = FULL_GRID)
+    {
+        string result;
+        encode(msg, rounds, result, alphabet, filler);
+        return result;
+    }
+
+    // Plaintext length before any '.' handling for a ciphertext length
+    inline int decodedLength(int length, int rounds, int filler = FULL_GRID) { return RoundMap::decoding(length, rounds, filler)->getOutputLength(); }
+
+    // Decrypt the first count characters (no '.' handling) into a caller buffer
+    inline void decodePrefixInto(string_view cipher, int rounds, char *out, int count, int filler)
+    {
+        MetricsTimer timer(Metrics::Decode, rounds);
+        shared_ptr<const RoundMap> map = RoundMap::decoding(static_cast<int>(cipher.size()), rounds, filler);
+        map->getPlan().apply(cipher.data(), out, count);
+        recordDecode(cipher.size(), min(count, map->getOutputLength()));
+    }
+
+    // Decrypt with a decoding map already resolved for cipher.size() into a caller buffer of
+    // map.getOutputLength() characters; returns the length kept
+    inline size_t decodeInto(const RoundMap &map, string_view cipher, char *out, bool stopAtDot)
+    {
+        MetricsTimer timer(Metrics::Decode, static_cast<int>(map.getGridSizes().size()));
+        map.getPlan().apply(cipher.data(), out);
+
+        size_t kept = keptLength(out, map.getOutputLength(), stopAtDot);
+        recordDecode(cipher.size(), kept);
+        return kept;
+    }
+
+    inline void decodeInto(string_view cipher, int rounds, char *out, int count) { decodePrefixInto(cipher, rounds, out, count, FULL_GRID); }
+
+    // Decrypt into a caller buffer of capacity characters; returns the length kept
+    inline size_t decodeInto(string_view cipher, int rounds, char *out, size_t capacity, bool stopAtDot, int filler = FULL_GRID)
+    {
+        shared_ptr<const RoundMap> map = RoundMap::decoding(static_cast<int>(cipher.size()), rounds, filler);
+        if (static_cast<size_t>(map->getOutputLength()) > capacity)
+            throw CustomException("Output buffer too small for the plaintext", true);
+        return decodeInto(*map, cipher, out, stopAtDot);
+    }
+
+    // Decrypt into out, reusing its capacity; out must not alias cipher
+    inline void decode(string_view cipher, int rounds, string &out, bool stopAtDot = true, int filler = FULL_GRID)
+    {
+        shared_ptr<const RoundMap> map = RoundMap::decoding(static_cast<int>(cipher.size()), rounds, filler);
+        size_t length = map->getOutputLength();
+        recordGrowth(out, length);
+        out.resize(length);
+        out.resize(decodeInto(*map, cipher, &out[0], stopAtDot));
+    }
+
+    // Decrypt a ciphertext over a number of rounds, stopping after the first '.' unless told otherwise
+    inline string decode(string_view cipher, int rounds, bool stopAtDot = true, int filler = FULL_GRID)
+    {
+        string result;
+        decode(cipher, rounds, result, stopAtDot, filler);
+        return result;
+    }
+
+    // Row-major cell of diamond character k, without a table.
+    // Ring r starts at 2r(size - r): size - 2r cells down the left side (rows r..size-1-r),
+    // then size - 2 - 2r cells up the right side (rows size-2-r..r+1).
+    inline int diamondCell(int size, int k)
+    {
+        int tip = size / 2;
+        int ring = static_cast<int>((size - sqrt(static_cast<double>(size) * size - 2.0 * k)) / 2);
+        while (ring > 0 && 2 * ring * (size - ring) > k)
+            ring--;
+        while (2 * (ring + 1) * (size - ring - 1) <= k && ring < tip)
+            ring++;
+
+        int offset = k - 2 * ring * (size - ring);
+        int left = size - 2 * ring;
+        if (offset < left)
+        {
+            int row = ring + offset;
+            return row * size + ring + abs(row - tip);
+        }
+        int row = size - 2 - ring - (offset - left);
+        return row * size + size - 1 - ring - abs(row - tip);
+    }
+
+    // Decrypt only plaintext characters [begin, end) (no '.' handling) of a FULL_GRID ciphertext into a caller buffer.
+    // Each index is walked back through the rounds arithmetically; no grid or map is built.
+    inline void decodeRange(string_view cipher, int rounds, size_t begin, size_t end, char *out)
+    {
+        if (rounds < 1)
+            throw CustomException("Round number must be greater than 0", true);
+        MetricsTimer timer(Metrics::Decode, rounds);
+        vector<int> sizes = RoundMap::decodeGridSizes(static_cast<int>(cipher.size()), rounds);
+        size_t length = sizes.back() * sizes.back() / 2 + 1;
+        if (begin > end || end > length)
+            throw CustomException("Range is outside the decoded message", true);
+
+        for (size_t k = begin; k < end; k++)
+        {
+            int position = static_cast<int>(k);
+            for (int round = rounds - 1; round >= 0; round--)
+                position = diamondCell(sizes[round], position);
+            out[k - begin] = cipher[position];
+        }
+        recordDecode(end - begin, end - begin);
+    }
+
+    inline string decodeRange(string_view cipher, int rounds, size_t begin, size_t end)
+    {
+        string result(end > begin ? end - begin : 0, ' ');
+        decodeRange(cipher, rounds, begin, end, &result[0]);
+        return result;
+    }
+}
+
+#endif // DIAMOND_CODEC_HPP
@@ -0,0 +1,366 @@
+#ifndef DIAMOND_TABLE_HPP
+#define DIAMOND_TABLE_HPP
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cmath>
+#include <tuple>
+#include <algorithm>
+#include "custom_exception.hpp"
+#include "gather_kernels.hpp"
+#include "codec_metrics.hpp"
+
+using namespace std;
+
+// Permutation table for one grid size.
+// Entry k is the flat row-major cell (row * size + col) that holds the k-th
+// character of the message in the diamond traversal pattern.
+class DiamondTable
+{
+private:
+    int grid_size;
+    vector<int> cells;
+    vector<int> compact_cells;       // position of each character among the diamond cells only, row-major
+    diamond::GatherPlan decode_plan; // s*s ciphertext -> diamond characters
+    diamond::GatherPlan encode_plan; // diamond characters plus one blank -> s*s cells
+
+    // Walk the diamond once, ring by ring, recording the cell of each character
+    void build()
+    {
+        int size = grid_size;
+        int tip = size / 2;
+        int length = size * size / 2 + 1;
+
+        int max_chars_half = 1 + tip * 2;
+        int upper_offset = 0, lower_offset = tip - 1;
+        int counter = 0;
+        int msg_index = 0;
+
+        cells.resize(length);
+        while (msg_index < length)
+        {
+            // Upper half (left side of the ring)
+            for (int i = counter; i < max_chars_half && msg_index < length; i++, msg_index++)
+            {
+                int row = i;
+                int col = (i <= tip) ? (tip - upper_offset++) : (tip - lower_offset--);
+                cells[msg_index] = row * size + col;
+            }
+
+            lower_offset = 1;
+            // Lower half (right side of the ring)
+            for (int j = size - 2 - counter; j > counter && msg_index < length; j--, msg_index++)
+            {
+                int col = tip + lower_offset;
+                cells[msg_index] = j * size + col;
+                lower_offset = (j > tip) ? lower_offset + 1 : lower_offset - 1;
+            }
+
+            max_chars_half--;
+            upper_offset = 0;
+            counter++;
+            lower_offset = tip - counter - 1;
+        }
+    }
+
+public:
+    explicit DiamondTable(int size) : grid_size(size)
+    {
+        build();
+
+        // Encoding as a gather: cells outside the diamond read the blank at index length
+        int length = getDiamondSize();
+        vector<int> inverse(size * size, length);
+        for (int k = 0; k < length; k++)
+            inverse[cells[k]] = k;
+
+        // Rank of each diamond cell in row-major order
+        vector<int> rank(size * size, 0);
+        for (int k = 0; k < length; k++)
+            rank[cells[k]] = 1;
+        for (int cell = 0, count = 0; cell < size * size; cell++)
+        {
+            int inside = rank[cell];
+            rank[cell] = count;
+            count += inside;
+        }
+        compact_cells.resize(length);
+        for (int k = 0; k < length; k++)
+            compact_cells[k] = rank[cells[k]];
+
+        decode_plan = diamond::GatherPlan(cells, size * size);
+        encode_plan = diamond::GatherPlan(inverse, length + 1);
+    }
+
+    // Cached table for a grid size, built on first use and shared by all threads
+    static const DiamondTable &forSize(int size)
+    {
+        // Per-thread front cache so the hot path never takes the lock
+        thread_local vector<const DiamondTable *> local;
+        if (size < static_cast<int>(local.size()) && local[size] != nullptr)
+            return *local[size];
+
+        static mutex cache_mutex;
+        static vector<unique_ptr<DiamondTable>> cache;
+
+        const DiamondTable *table;
+        {
+            lock_guard<mutex> lock(cache_mutex);
+            if (size >= static_cast<int>(cache.size()))
+                cache.resize(size + 1);
+            if (!cache[size])
+            {
+                cache[size].reset(new DiamondTable(size));
+                diamond::Metrics::add(diamond::Metrics::MapBuilds);
+            }
+            table = cache[size].get();
+        }
+
+        if (size >= static_cast<int>(local.size()))
+            local.resize(size + 1, nullptr);
+        local[size] = table;
+        return *table;
+    }
+
+    // Getters
+    int getGridSize() const { return grid_size; }
+    int getDiamondSize() const { return static_cast<int>(cells.size()); }
+    const vector<int> &getCells() const { return cells; }
+    const vector<int> &getCompactCells() const { return compact_cells; }
+    const diamond::GatherPlan &getDecodePlan() const { return decode_plan; }
+    const diamond::GatherPlan &getEncodePlan() const { return encode_plan; }
+    int operator[](int index) const { return cells[index]; }
+};
+
+// Composed permutation for a whole multi-round run.
+// Entry p of an encoding map is the plaintext index that ends up at ciphertext
+// position p after every round, or FILLER when the cell only ever held padding.
+// Entry k of a decoding map is the ciphertext position of the k-th decoded character.
+//
+// Maps come in two layouts. FULL_GRID rounds emit all size * size cells, so every
+// round roughly doubles the text. Compact rounds emit only the diamond cells in
+// row-major order followed by min(filler, 2 * size - 2) filler cells, so each round
+// adds O(sqrt(length)) characters at most.
+class RoundMap
+{
+public:
+    static constexpr int FILLER = -1;
+    static constexpr int FULL_GRID = -1;
+    static constexpr int MAX_GRID_SIZE = 99;
+    static constexpr size_t MAX_CACHED_MAPS = 1024;
+
+private:
+    vector<int> sources;
+    vector<int> grid_sizes;   // grid size chosen for each round
+    vector<pair<int, int>> filler_runs; // encoding only: (start, length) of each padding region
+    int filler_count = 0;
+    diamond::GatherPlan plan; // filler positions read index 0 and are overwritten afterwards
+
+    RoundMap() = default;
+
+public:
+    // Smallest odd grid whose diamond holds the message (same rule as Grid::autoGridSize)
+    static int encodeGridSize(int length, int limit = MAX_GRID_SIZE)
+    {
+        int size = 3;
+        while ((size * size / 2 + 1) < length)
+        {
+            size += 2;
+            if (size > limit)
+                throw CustomException("Message too long for maximum grid size", true);
+        }
+        return size;
+    }
+
+    // Largest odd grid contained in the message (same rule as Decryption::autoGridSize)
+    static int decodeGridSize(int length)
+    {
+        int root = static_cast<int>(sqrt(length));
+        return root % 2 == 0 ? root - 1 : root;
+    }
+
+    // Grid size of every decoding round; sizes follow the truncate_decrypt_message() chain
+    static vector<int> decodeGridSizes(int length, int rounds)
+    {
+        vector<int> sizes;
+        for (int round = 0; round < rounds; round++)
+        {
+            int size = decodeGridSize(length);
+            if (size < 1)
+                throw CustomException("Message too short for the number of rounds", true);
+            sizes.push_back(size);
+
+            int decoded = size * size / 2 + 1;
+            int root = static_cast<int>(sqrt(decoded));
+            length = root * root < decoded ? root * root : decoded;
+        }
+        return sizes;
+    }
+
+    // Characters one compact round emits for a grid size.
+    // Capping the filler below 2 * size - 2 keeps the output short of the next grid's
+    // diamond, which is what lets the decoder recover every grid size from the length.
+    static int compactLength(int size, int filler)
+    {
+        return size * size / 2 + 1 + min(filler, 2 * size - 2);
+    }
+
+    // Grid size of every compact decoding round. The ciphertext length names the last
+    // grid exactly; with filler each earlier round used the next smaller grid, without
+    // filler the output already fills its diamond and the grid size stays put.
+    static vector<int> compactDecodeGridSizes(int length, int rounds, int filler)
+    {
+        int size = 3;
+        while (size <= MAX_GRID_SIZE && compactLength(size, filler) < length)
+            size += 2;
+        if (size > MAX_GRID_SIZE || compactLength(size, filler) != length)
+            throw CustomException("Ciphertext length does not match a compact grid", true);
+
+        vector<int> sizes;
+        for (int round = 0; round < rounds; round++)
+        {
+            if (size < 3)
+                throw CustomException("Message too short for the number of rounds", true);
+            sizes.push_back(size);
+            if (filler > 0)
+                size -= 2;
+        }
+        return sizes;
+    }
+
+private:
+    static RoundMap buildEncoding(int length, int rounds, int filler)
+    {
+        RoundMap map;
+        map.sources.resize(length);
+        for (int i = 0; i < length; i++)
+            map.sources[i] = i;
+
+        for (int round = 0; round < rounds; round++)
+        {
+            int size = encodeGridSize(length);
+            const DiamondTable &table = DiamondTable::forSize(size);
+
+            if (filler == FULL_GRID)
+            {
+                vector<int> next(size * size, FILLER);
+                for (int k = 0; k < length; k++)
+                    next[table[k]] = map.sources[k];
+                map.sources.swap(next);
+            }
+            else
+            {
+                const vector<int> &compact = table.getCompactCells();
+                vector<int> next(compactLength(size, filler), FILLER);
+                for (int k = 0; k < length; k++)
+                    next[compact[k]] = map.sources[k];
+                map.sources.swap(next);
+            }
+            map.grid_sizes.push_back(size);
+            length = static_cast<int>(map.sources.size());
+        }
+        return map;
+    }
+
+    static RoundMap buildDecoding(int length, int rounds, int filler)
+    {
+        RoundMap map;
+        map.grid_sizes = filler == FULL_GRID ? decodeGridSizes(length, rounds) : compactDecodeGridSizes(length, rounds, filler);
+
+        // Walk back from the last round to the ciphertext
+        for (int round = rounds - 1; round >= 0; round--)
+        {
+            const DiamondTable &table = DiamondTable::forSize(map.grid_sizes[round]);
+            const vector<int> &positions = filler == FULL_GRID ? table.getCells() : table.getCompactCells();
+            if (round == rounds - 1)
+                map.sources = positions;
+            else
+                for (int &source : map.sources)
+                    source = positions[source];
+        }
+        return map;
+    }
+
+    void buildPlan(int source_length)
+    {
+        vector<int> indices(sources);
+        for (int p = 0; p < static_cast<int>(indices.size()); p++)
+        {
+            if (indices[p] != FILLER)
+                continue;
+            filler_count++;
+            if (!filler_runs.empty() && filler_runs.back().first + filler_runs.back().second == p)
+                filler_runs.back().second++;
+            else
+                filler_runs.emplace_back(p, 1);
+            indices[p] = 0;
+        }
+        if (source_length > 0)
+            plan = diamond::GatherPlan(indices, source_length);
+    }
+
+    static shared_ptr<const RoundMap> cached(bool encoding, int length, int rounds, int filler)
+    {
+        if (rounds < 1)
+            throw CustomException("Round number must be greater than 0", true);
+        if (filler < FULL_GRID)
+            throw CustomException("Filler count must not be negative", true);
+        // The encoder never builds a larger grid; larger ciphertexts belong to the tiled codec
+        if (!encoding && filler == FULL_GRID && decodeGridSize(length) > MAX_GRID_SIZE)
+            throw CustomException("Ciphertext too long for maximum grid size", true);
+
+        auto key = make_tuple(length, rounds * (encoding ? 1 : -1), filler);
+
+        thread_local map<tuple<int, int, int>, shared_ptr<const RoundMap>> local;
+        auto hit = local.find(key);
+        if (hit != local.end())
+            return hit->second;
+
+        static mutex cache_mutex;
+        static map<tuple<int, int, int>, shared_ptr<const RoundMap>> cache;
+        {
+            lock_guard<mutex> lock(cache_mutex);
+            auto found = cache.find(key);
+            if (found != cache.end())
+                return local[key] = found->second;
+        }
+
+        // Built outside the lock, so one large map does not stall every other thread
+        shared_ptr<RoundMap> built(new RoundMap(encoding ? buildEncoding(length, rounds, filler) : buildDecoding(length, rounds, filler)));
+        built->buildPlan(length);
+        diamond::Metrics::add(diamond::Metrics::MapBuilds);
+
+        shared_ptr<const RoundMap> result = built;
+        {
+            lock_guard<mutex> lock(cache_mutex);
+            auto found = cache.find(key);
+            if (found != cache.end())
+                result = found->second; // another thread got there first
+            else if (cache.size() < MAX_CACHED_MAPS)
+                cache[key] = result;
+            else
+                return result; // cache full: the caller holds the only reference
+        }
+        return local[key] = result;
+    }
+
+public:
+    // Maps built once per (length, rounds, filler); filler is FULL_GRID or a compact filler count.
+    // At most MAX_CACHED_MAPS are cached, so untrusted lengths cannot grow memory without bound;
+    // past that a map lives only as long as the caller holds on to it.
+    static shared_ptr<const RoundMap> encoding(int length, int rounds, int filler = FULL_GRID) { return cached(true, length, rounds, filler); }
+    static shared_ptr<const RoundMap> decoding(int length, int rounds, int filler = FULL_GRID) { return cached(false, length, rounds, filler); }
+
+    // Getters
+    int getOutputLength() const { return static_cast<int>(sources.size()); }
+    const vector<int> &getSources() const { return sources; }
+    const vector<int> &getGridSizes() const { return grid_sizes; }
+    const vector<pair<int, int>> &getFillerRuns() const { return filler_runs; }
+    int getFillerCount() const { return filler_count; }
+    const diamond::GatherPlan &getPlan() const { return plan; }
+    int operator[](int index) const { return sources[index]; }
+};
+
+#endif // DIAMOND_TABLE_HPP
@@ -0,0 +1,119 @@
+#ifndef FILLER_RNG_HPP
+#define FILLER_RNG_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <random>
+#include <thread>
+#include <functional>
+
+using namespace std;
+
+namespace diamond
+{
+    // xoshiro256** generator for filler letters.
+    // One instance per thread, so filling never contends on shared state.
+    class FillerRng
+    {
+    private:
+        uint64_t state[4];
+
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        static uint64_t splitmix(uint64_t &x)
+        {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+    public:
+        explicit FillerRng(uint64_t value) { seed(value); }
+
+        void seed(uint64_t value)
+        {
+            for (uint64_t &word : state)
+                word = splitmix(value);
+        }
+
+        // Seed for one unit of work (e.g. a block) under a base seed, independent of thread
+        void seed(uint64_t value, uint64_t stream)
+        {
+            uint64_t mixed = value ^ (stream * 0xD1B54A32D192ED03ULL);
+            seed(splitmix(mixed));
+        }
+
+        uint64_t next()
+        {
+            uint64_t result = rotl(state[1] * 5, 7) * 9;
+            uint64_t t = state[1] << 17;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+            return result;
+        }
+
+        // Four letters per draw, 16 bits each scaled into 0..25.
+        // Long fills draw a block first and convert it after, so the conversion vectorizes;
+        // the letters come out the same either way.
+        void fillLetters(char *out, size_t count)
+        {
+            const size_t BLOCK = 64;
+            size_t i = 0;
+            for (; i + BLOCK <= count; i += BLOCK)
+            {
+                uint16_t words[BLOCK];
+                for (size_t w = 0; w < BLOCK; w += 4)
+                {
+                    uint64_t bits = next();
+                    for (int lane = 0; lane < 4; lane++)
+                        words[w + lane] = static_cast<uint16_t>(bits >> (16 * lane));
+                }
+                for (size_t k = 0; k < BLOCK; k++)
+                    out[i + k] = static_cast<char>('A' + ((words[k] * 26u) >> 16));
+            }
+            for (; i + 4 <= count; i += 4)
+            {
+                uint64_t bits = next();
+                for (int lane = 0; lane < 4; lane++, bits >>= 16)
+                    out[i + lane] = static_cast<char>('A' + (((bits & 0xFFFF) * 26) >> 16));
+            }
+            if (i < count)
+            {
+                uint64_t bits = next();
+                for (; i < count; i++, bits >>= 16)
+                    out[i] = static_cast<char>('A' + (((bits & 0xFFFF) * 26) >> 16));
+            }
+        }
+
+        // Bytes from the full range except '.', eight per draw, so a '.' terminator
+        // stays recognisable after binary payloads
+        void fillBytes(char *out, size_t count)
+        {
+            for (size_t i = 0; i < count; i += 8)
+            {
+                uint64_t bits = next();
+                for (size_t lane = 0; lane < 8 && i + lane < count; lane++, bits >>= 8)
+                {
+                    unsigned value = static_cast<unsigned>((bits & 0xFF) * 255 >> 8);
+                    out[i + lane] = static_cast<char>(value >= '.' ? value + 1 : value);
+                }
+            }
+        }
+
+        char letter() { return static_cast<char>('A' + ((next() >> 48) * 26 >> 16)); }
+
+        // This thread's generator, seeded from the system on first use
+        static FillerRng &local()
+        {
+            thread_local FillerRng rng(static_cast<uint64_t>(random_device()()) << 32 ^ hash<thread::id>()(this_thread::get_id()));
+            return rng;
+        }
+    };
+}
+
+#endif // FILLER_RNG_HPP
@@ -0,0 +1,148 @@
+#ifndef FIXED_CODEC_HPP
+#define FIXED_CODEC_HPP
+
+#include <array>
+#include <utility>
+#include <cstring>
+#include <string_view>
+
+using namespace std;
+
+namespace diamond
+{
+    // Largest grid with a compile-time specialization
+    constexpr int MAX_FIXED_SIZE = 31;
+
+    // Diamond walk for a grid size known at compile time.
+    // Same traversal as DiamondTable::build(), evaluated by the compiler.
+    template <int N>
+    struct DiamondLayout
+    {
+        static_assert(N >= 3 && N % 2 == 1, "Grid size must be odd and at least 3");
+
+        static constexpr int CELL_COUNT = N * N;
+        static constexpr int DIAMOND_SIZE = N * N / 2 + 1;
+
+        static constexpr array<int, DIAMOND_SIZE> walk()
+        {
+            array<int, DIAMOND_SIZE> cells{};
+            int tip = N / 2;
+            int max_chars_half = 1 + tip * 2;
+            int upper_offset = 0, lower_offset = tip - 1;
+            int counter = 0;
+            int msg_index = 0;
+
+            while (msg_index < DIAMOND_SIZE)
+            {
+                for (int i = counter; i < max_chars_half && msg_index < DIAMOND_SIZE; i++, msg_index++)
+                {
+                    int col = (i <= tip) ? (tip - upper_offset++) : (tip - lower_offset--);
+                    cells[msg_index] = i * N + col;
+                }
+
+                lower_offset = 1;
+                for (int j = N - 2 - counter; j > counter && msg_index < DIAMOND_SIZE; j--, msg_index++)
+                {
+                    cells[msg_index] = j * N + tip + lower_offset;
+                    lower_offset = (j > tip) ? lower_offset + 1 : lower_offset - 1;
+                }
+
+                max_chars_half--;
+                upper_offset = 0;
+                counter++;
+                lower_offset = tip - counter - 1;
+            }
+            return cells;
+        }
+
+        // Cell -> diamond index, or DIAMOND_SIZE (the blank) outside the diamond
+        static constexpr array<int, CELL_COUNT> invert()
+        {
+            array<int, CELL_COUNT> inverse{};
+            for (int c = 0; c < CELL_COUNT; c++)
+                inverse[c] = DIAMOND_SIZE;
+            for (int k = 0; k < DIAMOND_SIZE; k++)
+                inverse[cells[k]] = k;
+            return inverse;
+        }
+
+        static constexpr array<int, DIAMOND_SIZE> cells = walk();
+        static constexpr array<int, CELL_COUNT> inverse = invert();
+    };
+
+    // One round of the diamond for a fixed grid size. Every index is a compile-time
+    // constant and the loops are unrolled, so each character is a single load and store.
+    template <int N>
+    class DiamondCodec
+    {
+    private:
+        using Layout = DiamondLayout<N>;
+
+        template <size_t... I>
+        static void scatterCells(const char *source, char *cells, index_sequence<I...>)
+        {
+            ((cells[I] = source[Layout::inverse[I]]), ...);
+        }
+
+        template <size_t... K>
+        static void gatherCells(const char *cells, char *out, index_sequence<K...>)
+        {
+            ((out[K] = cells[Layout::cells[K]]), ...);
+        }
+
+    public:
+        static constexpr int GRID_SIZE = N;
+        static constexpr int CELL_COUNT = Layout::CELL_COUNT;
+        static constexpr int DIAMOND_SIZE = Layout::DIAMOND_SIZE;
+
+        // Row-major cells from at most DIAMOND_SIZE characters; the rest become ' '
+        static void scatter(string_view msg, char *cells)
+        {
+            char source[DIAMOND_SIZE + 1];
+            memcpy(source, msg.data(), msg.size());
+            memset(source + msg.size(), ' ', DIAMOND_SIZE + 1 - msg.size());
+            scatterCells(source, cells, make_index_sequence<CELL_COUNT>());
+        }
+
+        // DIAMOND_SIZE characters out of the cells
+        static void gather(const char *cells, char *out)
+        {
+            gatherCells(cells, out, make_index_sequence<DIAMOND_SIZE>());
+        }
+    };
+
+    using FixedScatter = void (*)(string_view, char *);
+    using FixedGather = void (*)(const char *, char *);
+
+    // Specializations for odd sizes 3, 5, ..., MAX_FIXED_SIZE, indexed by (size - 3) / 2
+    template <size_t... I>
+    constexpr array<FixedScatter, sizeof...(I)> fixedScatters(index_sequence<I...>)
+    {
+        return {{&DiamondCodec<3 + 2 * static_cast<int>(I)>::scatter...}};
+    }
+
+    template <size_t... I>
+    constexpr array<FixedGather, sizeof...(I)> fixedGathers(index_sequence<I...>)
+    {
+        return {{&DiamondCodec<3 + 2 * static_cast<int>(I)>::gather...}};
+    }
+
+    constexpr size_t FIXED_COUNT = (MAX_FIXED_SIZE - 1) / 2;
+
+    inline bool hasFixedCodec(int size) { return size >= 3 && size <= MAX_FIXED_SIZE && size % 2 == 1; }
+
+    // Runtime dispatch to DiamondCodec<size>; the size must satisfy hasFixedCodec
+    inline void fixedScatter(string_view msg, int size, char *cells)
+    {
+        static constexpr array<FixedScatter, FIXED_COUNT> table = fixedScatters(make_index_sequence<FIXED_COUNT>());
+        table[(size - 3) / 2](msg, cells);
+    }
+
+    inline void fixedGather(const char *cells, int size, char *out)
+    {
+        static constexpr array<FixedGather, FIXED_COUNT> table = fixedGathers(make_index_sequence<FIXED_COUNT>());
+        table[(size - 3) / 2](cells, out);
+    }
+}
+
+#endif // FIXED_CODEC_HPP
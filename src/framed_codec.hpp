@@ -0,0 +1,119 @@
+#ifndef FRAMED_CODEC_HPP
+#define FRAMED_CODEC_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstring>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+
+using namespace std;
+
+// Framed format: "<length>,<rounds>:" followed by the ciphertext.
+// The header carries the exact plaintext length, so no '.' terminator is added,
+// the decoder gathers exactly length characters and '.' is an ordinary payload character.
+// The header is always parsed from the start of the frame, so it is unambiguous for
+// binary ciphertext too.
+namespace diamond
+{
+    struct FrameHeader
+    {
+        int length = 0;
+        int rounds = 0;
+        size_t header_length = 0; // characters before the ciphertext
+    };
+
+    // Largest header: two 10-digit numbers, ',' and ':'
+    constexpr size_t MAX_FRAME_HEADER = 22;
+
+    // Most rounds a frame may claim; the daemon's wire format carries rounds in 16 bits too
+    constexpr int MAX_FRAME_ROUNDS = 0xFFFF;
+
+    // Header text into a buffer of MAX_FRAME_HEADER + 1 characters; returns its length
+    inline size_t formatFrameHeader(int length, int rounds, char *header)
+    {
+        return static_cast<size_t>(snprintf(header, MAX_FRAME_HEADER + 1, "%d,%d:", length, rounds));
+    }
+
+    // Total framed length for a plaintext length
+    inline size_t framedLength(int length, int rounds)
+    {
+        char header[MAX_FRAME_HEADER + 1];
+        return formatFrameHeader(length, rounds, header) + encodedLength(length, rounds);
+    }
+
+    inline FrameHeader parseFrameHeader(string_view framed)
+    {
+        FrameHeader header;
+        long long values[2] = {0, 0};
+        const char separators[2] = {',', ':'};
+        size_t pos = 0;
+
+        for (int field = 0; field < 2; field++)
+        {
+            size_t start = pos;
+            while (pos < framed.size() && framed[pos] >= '0' && framed[pos] <= '9' && pos - start < 10)
+                values[field] = values[field] * 10 + (framed[pos++] - '0');
+            if (pos == start || pos >= framed.size() || framed[pos] != separators[field])
+                throw CustomException("Malformed frame header", true);
+            pos++;
+        }
+
+        // Ten digits can exceed INT_MAX, so both fields are range-checked before the casts
+        if (values[0] > RoundMap::MAX_GRID_SIZE * RoundMap::MAX_GRID_SIZE || values[1] < 1 || values[1] > MAX_FRAME_ROUNDS)
+            throw CustomException("Frame header is out of range", true);
+
+        header.length = static_cast<int>(values[0]);
+        header.rounds = static_cast<int>(values[1]);
+        header.header_length = pos;
+        return header;
+    }
+
+    // Frame into a caller buffer of framedLength(msg.size(), rounds) characters; returns the length written
+    inline size_t frameInto(string_view msg, int rounds, char *out, size_t capacity, Alphabet alphabet = Alphabet::Letters)
+    {
+        int length = static_cast<int>(msg.size());
+        size_t total = framedLength(length, rounds);
+        if (total > capacity)
+            throw CustomException("Output buffer too small for the frame", true);
+
+        char header[MAX_FRAME_HEADER + 1];
+        size_t header_length = formatFrameHeader(length, rounds, header);
+        memcpy(out, header, header_length);
+        encodeInto(msg, rounds, out + header_length, alphabet);
+        return total;
+    }
+
+    inline string frame(string_view msg, int rounds, Alphabet alphabet = Alphabet::Letters)
+    {
+        string result(framedLength(static_cast<int>(msg.size()), rounds), ' ');
+        frameInto(msg, rounds, &result[0], result.size(), alphabet);
+        return result;
+    }
+
+    // Plaintext of a frame into a caller buffer; returns the plaintext length.
+    // Only the plaintext cells are gathered and nothing is compared against '.'.
+    inline size_t unframeInto(string_view framed, char *out, size_t capacity)
+    {
+        FrameHeader header = parseFrameHeader(framed);
+        string_view cipher = framed.substr(header.header_length);
+        if (static_cast<int>(cipher.size()) != encodedLength(header.length, header.rounds))
+            throw CustomException("Frame length does not match its header", true);
+        if (static_cast<size_t>(header.length) > capacity)
+            throw CustomException("Output buffer too small for the plaintext", true);
+
+        decodeInto(cipher, header.rounds, out, header.length);
+        return header.length;
+    }
+
+    inline string unframe(string_view framed)
+    {
+        FrameHeader header = parseFrameHeader(framed);
+        string result(header.length, ' ');
+        unframeInto(framed, &result[0], result.size());
+        return result;
+    }
+}
+
+#endif // FRAMED_CODEC_HPP
@@ -0,0 +1,301 @@
+#ifndef GATHER_KERNELS_HPP
+#define GATHER_KERNELS_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DIAMOND_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace diamond
+{
+    // Byte permutation kernels, fastest first
+    enum class Kernel
+    {
+        Permute, // AVX-512 VBMI vpermi2b, sources up to 128 bytes
+        Shuffle, // SSSE3 pshufb, sources up to 256 bytes
+        Gather,  // AVX2 32-bit gathers, any size
+        Scalar
+    };
+
+    // CPU features, detected once at runtime
+    struct CpuFeatures
+    {
+        bool ssse3 = false;
+        bool avx2 = false;
+        bool avx512vbmi = false;
+
+        static const CpuFeatures &get()
+        {
+            static const CpuFeatures features = detect();
+            return features;
+        }
+
+    private:
+        static CpuFeatures detect()
+        {
+            CpuFeatures features;
+#ifdef DIAMOND_X86_KERNELS
+            __builtin_cpu_init();
+            features.ssse3 = __builtin_cpu_supports("ssse3");
+            features.avx2 = __builtin_cpu_supports("avx2");
+            features.avx512vbmi = __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw");
+#endif
+            return features;
+        }
+    };
+
+    // Precomputed byte gather: out[p] = src[index[p]] for every output position.
+    // Every index must lie in [0, source_length).
+    class GatherPlan
+    {
+    private:
+        static const int SHUFFLE_LIMIT = 256;
+        static const int PERMUTE_LIMIT = 128;
+
+        // One pshufb: pull the lanes of an output chunk that live in one source chunk
+        struct ShuffleStep
+        {
+            uint8_t control[16];
+            int source_chunk;
+        };
+
+        int source_length = 0;
+        int output_length = 0;
+        vector<int32_t> index;             // padded with zeros to a multiple of 8
+        vector<uint8_t> gather_safe;       // per group of 8: every 4-byte load stays in bounds
+        vector<ShuffleStep> shuffle_steps; // grouped by output chunk
+        vector<int> shuffle_begin;         // first step of each output chunk, plus an end marker
+        vector<uint8_t> permute_index;     // byte indices padded to a multiple of 64
+        Kernel kernel = Kernel::Scalar;
+
+        void buildShuffle()
+        {
+            int chunks = (output_length + 15) / 16;
+            int source_chunks = (source_length + 15) / 16;
+            for (int o = 0; o < chunks; o++)
+            {
+                shuffle_begin.push_back(static_cast<int>(shuffle_steps.size()));
+                for (int c = 0; c < source_chunks; c++)
+                {
+                    ShuffleStep step;
+                    step.source_chunk = c;
+                    bool used = false;
+                    for (int lane = 0; lane < 16; lane++)
+                    {
+                        int p = o * 16 + lane;
+                        bool here = p < output_length && index[p] / 16 == c;
+                        step.control[lane] = here ? static_cast<uint8_t>(index[p] % 16) : 0x80;
+                        used = used || here;
+                    }
+                    if (used)
+                        shuffle_steps.push_back(step);
+                }
+            }
+            shuffle_begin.push_back(static_cast<int>(shuffle_steps.size()));
+        }
+
+        void buildPermute()
+        {
+            permute_index.assign((output_length + 63) / 64 * 64, 0);
+            for (int p = 0; p < output_length; p++)
+                permute_index[p] = static_cast<uint8_t>(index[p]);
+        }
+
+        void buildGather()
+        {
+            int groups = (output_length + 7) / 8;
+            gather_safe.assign(groups, 1);
+            for (int p = 0; p < output_length; p++)
+                if (index[p] + 4 > source_length)
+                    gather_safe[p / 8] = 0;
+        }
+
+        // Tiny outputs stay scalar; multi-chunk pshufb programs lose to AVX2 gathers
+        Kernel choose() const
+        {
+            const CpuFeatures &cpu = CpuFeatures::get();
+            if (output_length < 16)
+                return Kernel::Scalar;
+            if (cpu.avx512vbmi && source_length <= PERMUTE_LIMIT)
+                return Kernel::Permute;
+            if (cpu.avx2 && output_length >= 64)
+                return Kernel::Gather;
+            if (cpu.ssse3 && !cpu.avx2 && source_length <= 64)
+                return Kernel::Shuffle;
+            return Kernel::Scalar;
+        }
+
+        void applyScalar(const char *src, char *out, int count) const
+        {
+            const int32_t *idx = index.data();
+            for (int p = 0; p < count; p++)
+                out[p] = src[idx[p]];
+        }
+
+#ifdef DIAMOND_X86_KERNELS
+        __attribute__((target("ssse3"))) void applyShuffle(const char *src, char *out, int count) const
+        {
+            // Stage the source so whole 16-byte chunks can be loaded
+            alignas(16) char staged[SHUFFLE_LIMIT];
+            memcpy(staged, src, source_length);
+
+            int chunks = (count + 15) / 16;
+            for (int o = 0; o < chunks; o++)
+            {
+                __m128i acc = _mm_setzero_si128();
+                for (int s = shuffle_begin[o]; s < shuffle_begin[o + 1]; s++)
+                {
+                    const ShuffleStep &step = shuffle_steps[s];
+                    __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i *>(staged + step.source_chunk * 16));
+                    __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i *>(step.control));
+                    acc = _mm_or_si128(acc, _mm_shuffle_epi8(chunk, control));
+                }
+
+                int remaining = count - o * 16;
+                if (remaining >= 16)
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + o * 16), acc);
+                else
+                {
+                    alignas(16) char tail[16];
+                    _mm_store_si128(reinterpret_cast<__m128i *>(tail), acc);
+                    memcpy(out + o * 16, tail, remaining);
+                }
+            }
+        }
+
+        __attribute__((target("avx512f,avx512bw,avx512vbmi"))) void applyPermute(const char *src, char *out, int count) const
+        {
+            int low = min(source_length, 64);
+            int high = source_length - low;
+            __m512i a = _mm512_maskz_loadu_epi8(low == 64 ? ~0ULL : (1ULL << low) - 1, src);
+            __m512i b = _mm512_maskz_loadu_epi8(high == 64 ? ~0ULL : (1ULL << high) - 1, src + low);
+
+            for (int o = 0; o < count; o += 64)
+            {
+                __m512i control = _mm512_loadu_si512(permute_index.data() + o);
+                __m512i result = _mm512_permutex2var_epi8(a, control, b);
+                int remaining = count - o;
+                __mmask64 mask = remaining >= 64 ? ~0ULL : (1ULL << remaining) - 1;
+                _mm512_mask_storeu_epi8(out + o, mask, result);
+            }
+        }
+
+        __attribute__((target("avx2"))) void applyGather(const char *src, char *out, int count) const
+        {
+            // Low byte of each 32-bit lane, packed into the bottom of each 128-bit half
+            const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            const int32_t *idx = index.data();
+            int groups = (count + 7) / 8;
+
+            for (int g = 0; g < groups; g++)
+            {
+                int base = g * 8;
+                int lanes = min(8, count - base);
+                if (!gather_safe[g])
+                {
+                    for (int p = base; p < base + lanes; p++)
+                        out[p] = src[idx[p]];
+                    continue;
+                }
+
+                __m256i offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(idx + base));
+                __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int *>(src), offsets, 1);
+                __m256i bytes = _mm256_shuffle_epi8(words, pick);
+                __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+
+                if (lanes == 8)
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + base), packed);
+                else
+                {
+                    alignas(16) char tail[16];
+                    _mm_store_si128(reinterpret_cast<__m128i *>(tail), packed);
+                    memcpy(out + base, tail, lanes);
+                }
+            }
+        }
+#endif
+
+    public:
+        GatherPlan() = default;
+
+        GatherPlan(const vector<int> &indices, int sourceLength)
+            : source_length(sourceLength), output_length(static_cast<int>(indices.size()))
+        {
+            index.assign(indices.begin(), indices.end());
+            index.resize((output_length + 7) / 8 * 8, 0);
+
+            kernel = choose();
+#ifdef DIAMOND_X86_KERNELS
+            if (source_length <= SHUFFLE_LIMIT)
+                buildShuffle();
+            if (source_length <= PERMUTE_LIMIT)
+                buildPermute();
+            buildGather();
+#endif
+        }
+
+        void apply(const char *src, char *out) const { apply(src, out, output_length, kernel); }
+
+        // Only the first count outputs
+        void apply(const char *src, char *out, int count) const { apply(src, out, count, kernel); }
+
+        void apply(const char *src, char *out, Kernel use) const { apply(src, out, output_length, use); }
+
+        // Run a specific kernel, falling back to scalar when it does not apply here
+        void apply(const char *src, char *out, int count, Kernel use) const
+        {
+            count = min(count, output_length);
+            if (!supports(use))
+                use = Kernel::Scalar;
+
+            switch (use)
+            {
+#ifdef DIAMOND_X86_KERNELS
+            case Kernel::Permute:
+                applyPermute(src, out, count);
+                return;
+            case Kernel::Shuffle:
+                applyShuffle(src, out, count);
+                return;
+            case Kernel::Gather:
+                applyGather(src, out, count);
+                return;
+#endif
+            default:
+                applyScalar(src, out, count);
+                return;
+            }
+        }
+
+        bool supports(Kernel use) const
+        {
+            const CpuFeatures &cpu = CpuFeatures::get();
+            switch (use)
+            {
+            case Kernel::Permute:
+                return cpu.avx512vbmi && !permute_index.empty();
+            case Kernel::Shuffle:
+                return cpu.ssse3 && !shuffle_begin.empty();
+            case Kernel::Gather:
+                return cpu.avx2 && !gather_safe.empty();
+            default:
+                return true;
+            }
+        }
+
+        // Getters
+        Kernel getKernel() const { return kernel; }
+        int getSourceLength() const { return source_length; }
+        int getOutputLength() const { return output_length; }
+    };
+}
+
+#endif // GATHER_KERNELS_HPP
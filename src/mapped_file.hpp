@@ -0,0 +1,342 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+#include "parallel_codec.hpp"
+#include "block_stream.hpp"
+
+using namespace std;
+
+// Whole file mapped into memory, unmapped and closed on destruction
+class MappedFile
+{
+private:
+    int fd = -1;
+    char *data = nullptr;
+    size_t length = 0;
+
+    MappedFile(int descriptor, char *mapping, size_t size) : fd(descriptor), data(mapping), length(size) {}
+
+    static CustomException systemError(const string &what, const string &path)
+    {
+        return CustomException(what + " '" + path + "': " + strerror(errno));
+    }
+
+    static char *mapFile(int descriptor, size_t size, int protection, const string &path)
+    {
+        if (size == 0)
+            return nullptr; // mmap rejects empty mappings
+
+        void *mapping = mmap(nullptr, size, protection, MAP_SHARED, descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            CustomException error = systemError("Cannot map", path);
+            close(descriptor);
+            throw error;
+        }
+        return static_cast<char *>(mapping);
+    }
+
+public:
+    static MappedFile openRead(const string &path)
+    {
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            throw systemError("Cannot open", path);
+
+        struct stat info;
+        if (fstat(descriptor, &info) < 0)
+        {
+            CustomException error = systemError("Cannot stat", path);
+            close(descriptor);
+            throw error;
+        }
+
+        size_t size = static_cast<size_t>(info.st_size);
+        return MappedFile(descriptor, mapFile(descriptor, size, PROT_READ, path), size);
+    }
+
+    // Whether path names this file, through any link; false if path does not exist
+    bool isSameFile(const string &path) const
+    {
+        struct stat mine, other;
+        if (fd < 0 || fstat(fd, &mine) < 0 || stat(path.c_str(), &other) < 0)
+            return false;
+        return mine.st_dev == other.st_dev && mine.st_ino == other.st_ino;
+    }
+
+    // Create (or truncate) a file of exactly size bytes and map it for writing
+    static MappedFile create(const string &path, size_t size)
+    {
+        int descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (descriptor < 0)
+            throw systemError("Cannot create", path);
+
+        if (ftruncate(descriptor, static_cast<off_t>(size)) < 0)
+        {
+            CustomException error = systemError("Cannot resize", path);
+            close(descriptor);
+            throw error;
+        }
+
+        return MappedFile(descriptor, mapFile(descriptor, size, PROT_READ | PROT_WRITE, path), size);
+    }
+
+    MappedFile(MappedFile &&other) noexcept : fd(other.fd), data(other.data), length(other.length)
+    {
+        other.fd = -1;
+        other.data = nullptr;
+        other.length = 0;
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (data != nullptr)
+            munmap(data, length);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    // Kernel hints for a byte range; the range is widened to whole pages
+    void advise(size_t offset, size_t size, int advice)
+    {
+        if (data == nullptr || size == 0)
+            return;
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset / page * page;
+        madvise(data + begin, min(length, offset + size) - begin, advice);
+    }
+
+    // Start writeback of a range without waiting (MS_ASYNC) or wait for all of it (MS_SYNC)
+    void sync(size_t offset, size_t size, int flags)
+    {
+        if (data == nullptr || size == 0)
+            return;
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset / page * page;
+        msync(data + begin, min(length, offset + size) - begin, flags);
+    }
+
+    void sync() { sync(0, length, MS_SYNC); }
+
+    // Getters
+    const char *getData() const { return data; }
+    char *getData() { return data; }
+    size_t getSize() const { return length; }
+    string_view view() const { return string_view(data, length); }
+};
+
+namespace diamond
+{
+    // Walks the meaningful characters of a mapped file block by block.
+    // Clean input (no whitespace, already uppercase) is handed out as views into the
+    // mapping; anything else is normalized into the caller's scratch string.
+    class BlockCursor
+    {
+    private:
+        string_view text;
+        size_t position = 0;
+        bool clean;
+
+        static bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    public:
+        BlockCursor(string_view input, bool isClean) : text(input), clean(isClean) {}
+
+        // Count the characters and validate them; clean is false when normalizing is needed.
+        // Binary input is always clean: every byte counts.
+        static size_t scan(string_view input, bool &isClean, bool binary = false)
+        {
+            size_t count = 0;
+            isClean = true;
+            if (binary)
+                return input.size();
+
+            for (char c : input)
+            {
+                if (isSpace(c))
+                {
+                    isClean = false;
+                    continue;
+                }
+                if (islower(static_cast<unsigned char>(c)))
+                    isClean = false;
+                else if (!(isupper(static_cast<unsigned char>(c)) || c == '.'))
+                    throw CustomException("Input must contain only letters (A-Z or a-z) and full stops.", true);
+                count++;
+            }
+            return count;
+        }
+
+        string_view next(size_t count, string &scratch)
+        {
+            if (clean)
+            {
+                string_view block = text.substr(position, count);
+                position += block.size();
+                return block;
+            }
+
+            scratch.clear();
+            while (scratch.size() < count && position < text.size())
+            {
+                char c = text[position++];
+                if (!isSpace(c))
+                    scratch += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+            }
+            return scratch;
+        }
+
+        void skip(size_t count)
+        {
+            string scratch;
+            if (clean)
+                position += count;
+            else
+                next(count, scratch);
+        }
+
+        size_t getPosition() const { return position; }
+    };
+
+    // Encodes or decodes a file between two memory mappings, in the same block
+    // format as BlockPipeline. The output is sized up front from the grid geometry
+    // and every block is written straight into its place in the output mapping.
+    class FileCodec
+    {
+    private:
+        StreamOptions options;
+        ParallelCodec codec;
+        size_t batch_blocks;
+
+        // Truncating the output would destroy the mapped input before it is read
+        static void checkDistinct(const MappedFile &in, const string &outPath)
+        {
+            if (in.isSameFile(outPath))
+                throw CustomException("Input and output must be different files", true);
+        }
+
+    public:
+        explicit FileCodec(const StreamOptions &opts)
+            : options(opts), codec(opts.threads), batch_blocks(16 * max(opts.threads, 1))
+        {
+            if (options.seeded)
+                codec.setSeed(options.seed);
+            if (options.binary)
+                codec.setAlphabet(Alphabet::Bytes);
+            codec.setFiller(options.filler);
+
+            if (options.block_size <= 0)
+                throw CustomException("Block size must be greater than 0", true);
+            encodedLength(options.block_size, options.rounds, options.filler);
+        }
+
+        void encode(const string &inPath, const string &outPath)
+        {
+            MappedFile in = MappedFile::openRead(inPath);
+            checkDistinct(in, outPath);
+            bool clean;
+            size_t count = BlockCursor::scan(in.view(), clean, options.binary);
+
+            size_t block = options.block_size;
+            size_t cipher_block = encodedLength(options.block_size, options.rounds, options.filler);
+            size_t full = count / block;
+            size_t rest = count % block;
+            size_t final_length = encodedLength(static_cast<int>(rest + 1), options.rounds, options.filler);
+
+            MappedFile out = MappedFile::create(outPath, full * cipher_block + final_length);
+            in.advise(0, in.getSize(), MADV_SEQUENTIAL);
+            out.advise(0, out.getSize(), MADV_SEQUENTIAL);
+
+            BlockCursor cursor(in.view(), clean);
+            vector<string> scratch(batch_blocks);
+            vector<string_view> views(batch_blocks);
+
+            for (size_t first = 0; first < full; first += batch_blocks)
+            {
+                size_t blocks = min(batch_blocks, full - first);
+                for (size_t i = 0; i < blocks; i++)
+                    views[i] = cursor.next(block, scratch[i]);
+
+                char *target = out.getData() + first * cipher_block;
+                codec.forEach(blocks, [&](size_t i)
+                              {
+                                  codec.seedBlock(first + i);
+                                  encodeInto(views[i], options.rounds, target + i * cipher_block, codec.getAlphabet(), options.filler); });
+
+                out.sync(first * cipher_block, blocks * cipher_block, MS_ASYNC);
+                in.advise(0, cursor.getPosition(), MADV_DONTNEED);
+            }
+
+            string last(cursor.next(rest, scratch[0]));
+            last += '.';
+            codec.seedBlock(full);
+            encodeInto(last, options.rounds, out.getData() + full * cipher_block, codec.getAlphabet(), options.filler);
+            out.sync();
+        }
+
+        void decode(const string &inPath, const string &outPath)
+        {
+            MappedFile in = MappedFile::openRead(inPath);
+            checkDistinct(in, outPath);
+            bool clean;
+            size_t count = BlockCursor::scan(in.view(), clean, options.binary);
+            if (count == 0)
+                throw CustomException("Ciphertext file is empty", true);
+
+            size_t block = options.block_size;
+            size_t cipher_block = encodedLength(options.block_size, options.rounds, options.filler);
+            size_t full = (count - 1) / cipher_block;
+
+            // The final block decides the output size
+            BlockCursor tail(in.view(), clean);
+            tail.skip(full * cipher_block);
+            string scratch_tail;
+            string final_block = diamond::decode(tail.next(cipher_block, scratch_tail), options.rounds, false, options.filler);
+            size_t end = final_block.rfind('.');
+            if (end == string::npos)
+                throw CustomException("Ciphertext file is missing its final block", true);
+
+            MappedFile out = MappedFile::create(outPath, full * block + end);
+            in.advise(0, in.getSize(), MADV_SEQUENTIAL);
+            out.advise(0, out.getSize(), MADV_SEQUENTIAL);
+
+            BlockCursor cursor(in.view(), clean);
+            vector<string> scratch(batch_blocks);
+            vector<string_view> views(batch_blocks);
+
+            for (size_t first = 0; first < full; first += batch_blocks)
+            {
+                size_t blocks = min(batch_blocks, full - first);
+                for (size_t i = 0; i < blocks; i++)
+                    views[i] = cursor.next(cipher_block, scratch[i]);
+
+                char *target = out.getData() + first * block;
+                codec.forEach(blocks, [&](size_t i)
+                              { decodePrefixInto(views[i], options.rounds, target + i * block, static_cast<int>(block), options.filler); });
+
+                out.sync(first * block, blocks * block, MS_ASYNC);
+                in.advise(0, cursor.getPosition(), MADV_DONTNEED);
+            }
+
+            copy(final_block.begin(), final_block.begin() + end, out.getData() + full * block);
+            out.sync();
+        }
+    };
+}
+
+#endif // MAPPED_FILE_HPP
@@ -48,7 +48,8 @@ void printMenu3_encrypt_multi()
     cout << "* " << "Select an option:                         *" << endl;
     cout << "* " << "1. Enter the round number                 *" << endl;
     cout << "* " << "2. For each round, print the grid and     *\n*    the corresponding encoded message      *" << endl;
-    cout << "* " << "3. Back                                   *" << endl;
+    cout << "* " << "3. Encrypt all rounds in one pass         *" << endl;
+    cout << "* " << "4. Back                                   *" << endl;
     cout << setw(46) << setfill('*') << "\n";
 }
 
@@ -60,7 +61,8 @@ void printMenu2_decrypt()
     cout << "* " << "1. Enter a message                     *" << endl;
     cout << "* " << "2. Enter the round number              *" << endl;
     cout << "* " << "3. For each round, print the grid      *\n*  and the corresponding decoded message *" << endl;
-    cout << "* " << "4. Back                                *" << endl;
+    cout << "* " << "4. Decode all rounds in one pass       *" << endl;
+    cout << "* " << "5. Back                                *" << endl;
     cout << setw(43) << setfill('*') << "\n";
 }
 
@@ -0,0 +1,109 @@
+#ifndef MENU_SESSION_HPP
+#define MENU_SESSION_HPP
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+// Thrown when the menu runs out of input (end of a script, or Ctrl-D)
+struct EndOfInput
+{
+};
+
+// Read one line for the menu; end of input ends the session instead of looping
+inline void readMenuLine(string &line)
+{
+    if (!getline(cin, line))
+        throw EndOfInput();
+}
+
+// Screen clears and readability pauses, skipped entirely in scripted sessions
+class Pacing
+{
+private:
+    static bool &interactive()
+    {
+        static bool on = true;
+        return on;
+    }
+
+public:
+    static void setInteractive(bool on) { interactive() = on; }
+    static bool isInteractive() { return interactive(); }
+
+    static void pause(int seconds)
+    {
+        if (interactive())
+            this_thread::sleep_for(chrono::seconds(seconds));
+    }
+
+    static void clearScreen()
+    {
+        if (interactive())
+            system("clear");
+    }
+};
+
+// Machine-readable results of a scripted session, one JSON object per line.
+// Interactive sessions report nothing.
+class SessionReport
+{
+private:
+    static ostream *&target()
+    {
+        static ostream *out = nullptr;
+        return out;
+    }
+
+    static string quote(const string &text)
+    {
+        string result = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                const char *hex = "0123456789abcdef";
+                result += "\\u00";
+                result += hex[(c >> 4) & 0xF];
+                result += hex[c & 0xF];
+            }
+            else
+                result += c;
+        }
+        return result + "\"";
+    }
+
+public:
+    static void setTarget(ostream *out) { target() = out; }
+
+    // {"event":..., "round":..., "of":..., "grid":..., "output":...}; zero fields are left out
+    static void result(const string &event, const string &output, int round = 0, int rounds = 0, int grid = 0)
+    {
+        ostream *out = target();
+        if (out == nullptr)
+            return;
+        *out << "{\"event\":" << quote(event);
+        if (round > 0)
+            *out << ",\"round\":" << round;
+        if (rounds > 0)
+            *out << ",\"of\":" << rounds;
+        if (grid > 0)
+            *out << ",\"grid\":" << grid;
+        *out << ",\"output\":" << quote(output) << "}\n";
+    }
+
+    static void error(const string &message)
+    {
+        ostream *out = target();
+        if (out != nullptr)
+            *out << "{\"event\":\"error\",\"message\":" << quote(message) << "}\n";
+    }
+};
+
+#endif // MENU_SESSION_HPP
@@ -0,0 +1,133 @@
+#ifndef PARALLEL_CODEC_HPP
+#define PARALLEL_CODEC_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "diamond_codec.hpp"
+#include "tiled_codec.hpp"
+#include "work_stealing_pool.hpp"
+
+using namespace std;
+
+namespace diamond
+{
+    // Encodes and decodes independent blocks on a pool of workers.
+    // Results come back in the same order as the input blocks. Every block is its own
+    // stealable task, so one huge block does not hold up the rest of a batch; blocks too
+    // large for the table codec go through the tiled codec with their row bands as
+    // further stealable tasks.
+    class ParallelCodec
+    {
+    private:
+        unique_ptr<WorkStealingPool> pool; // null when running on the calling thread
+        bool seeded = false;         // reproducible filler per block
+        uint64_t seed = 0;
+        Alphabet alphabet = Alphabet::Letters;
+        int filler = FULL_GRID;
+
+    public:
+        explicit ParallelCodec(int threads)
+        {
+            if (threads > 1)
+                pool.reset(new WorkStealingPool(threads));
+        }
+
+        // Filler depends only on the seed and the block number, not on the worker
+        void setSeed(uint64_t value)
+        {
+            seeded = true;
+            seed = value;
+        }
+
+        void setAlphabet(Alphabet value) { alphabet = value; }
+        Alphabet getAlphabet() const { return alphabet; }
+
+        // FULL_GRID or a compact filler count, for both directions
+        void setFiller(int value) { filler = value; }
+        int getFiller() const { return filler; }
+
+        // Call on the worker before encoding block index
+        void seedBlock(size_t index)
+        {
+            if (seeded)
+                seedFiller(seed, index);
+        }
+
+        // first_block numbers the blocks for seeding.
+        // Tiled blocks draw their filler on whichever worker runs each band, so they are not seeded.
+        void encodeBlocks(const vector<string> &blocks, int rounds, vector<string> &results, size_t first_block = 0)
+        {
+            results.resize(blocks.size());
+            forEach(blocks.size(), [&](size_t i)
+                    {
+                        if (filler == FULL_GRID && needsTiledEncode(static_cast<int>(blocks[i].size()), rounds))
+                            results[i] = encodeTiled(blocks[i], rounds, alphabet, bandRunner());
+                        else
+                        {
+                            seedBlock(first_block + i);
+                            results[i] = diamond::encode(blocks[i], rounds, alphabet, filler);
+                        } });
+        }
+
+        void decodeBlocks(const vector<string> &blocks, int rounds, bool stopAtDot, vector<string> &results)
+        {
+            results.resize(blocks.size());
+            forEach(blocks.size(), [&](size_t i)
+                    {
+                        if (filler == FULL_GRID && needsTiledDecode(blocks[i].size()))
+                            results[i] = decodeTiled(blocks[i], rounds, stopAtDot, bandRunner());
+                        else
+                            results[i] = diamond::decode(blocks[i], rounds, stopAtDot, filler); });
+        }
+
+        // Runs the bands of a tiled round as tasks of the pool
+        BandRunner bandRunner()
+        {
+            if (!pool)
+                return runBandsInOrder;
+            return [this](size_t count, const function<void(size_t)> &body)
+            { pool->forkJoin(count, body); };
+        }
+
+        // Scheduler totals go to the metrics registry after every batch
+        void forEach(size_t count, const function<void(size_t)> &body)
+        {
+            if (!pool)
+            {
+                for (size_t i = 0; i < count; i++)
+                    body(i);
+                return;
+            }
+
+            WorkStealingPool::Stats before = pool->getStats();
+            try
+            {
+                pool->forkJoin(count, body);
+            }
+            catch (...)
+            {
+                recordSchedule(before);
+                throw;
+            }
+            recordSchedule(before);
+        }
+
+        void recordSchedule(const WorkStealingPool::Stats &before)
+        {
+            if (!Metrics::enabled())
+                return;
+            WorkStealingPool::Stats after = pool->getStats();
+            Metrics::add(Metrics::TasksRun, after.tasks - before.tasks);
+            Metrics::add(Metrics::TasksStolen, after.steals - before.steals);
+            Metrics::add(Metrics::WorkerBusyNs, after.busy_ns - before.busy_ns);
+            Metrics::add(Metrics::WorkerWallNs, after.wall_ns - before.wall_ns);
+        }
+
+        WorkStealingPool::Stats getStats() const { return pool ? pool->getStats() : WorkStealingPool::Stats(); }
+
+        int getWorkerCount() const { return pool ? pool->getWorkerCount() : 1; }
+    };
+}
+
+#endif // PARALLEL_CODEC_HPP
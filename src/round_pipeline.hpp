@@ -0,0 +1,248 @@
+#ifndef ROUND_PIPELINE_HPP
+#define ROUND_PIPELINE_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <map>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+#include "bounded_queue.hpp"
+
+using namespace std;
+
+namespace diamond
+{
+    // Multi-round batch engine that pipelines rounds across messages.
+    // The rounds of one message depend on each other, but different messages do not, so
+    // each stage thread owns a contiguous range of rounds: while stage 1 runs round 2 of
+    // message m, stage 0 already runs round 1 of message m + 1. A message's buffers travel
+    // with it from stage to stage, and every round writes into the spare buffer and swaps,
+    // so nothing is copied between stages. Ciphertexts are interchangeable with
+    // encode()/decode() for the same rounds, alphabet and filler count.
+    class RoundPipeline
+    {
+    private:
+        static const size_t STOP = static_cast<size_t>(-1); // tells a stage to exit
+
+        struct Job
+        {
+            size_t index = STOP;
+            string text;
+            string spare;      // the next round writes here, then the two swap
+            vector<int> sizes; // decoding only: grid size of every round
+        };
+
+        int rounds;
+        int stage_limit;
+        size_t queue_capacity;
+        bool seeded = false;
+        uint64_t seed = 0;
+        Alphabet alphabet = Alphabet::Letters;
+        int filler = FULL_GRID;
+        PipelineGuard guard;
+        vector<int> stage_begin; // first round of each stage, plus an end marker
+
+        // Split the rounds into contiguous stages of roughly equal cost; every stage gets a round
+        void planStages(const vector<double> &costs)
+        {
+            int stages = min(stage_limit, rounds);
+            double total = 0;
+            for (double cost : costs)
+                total += cost;
+
+            stage_begin.assign(1, 0);
+            double done = 0;
+            for (int round = 0; round + 1 < rounds; round++)
+            {
+                done += costs[round];
+                int cuts = static_cast<int>(stage_begin.size()) - 1;
+                int cuts_left = stages - 1 - cuts;
+                if (cuts_left > 0 && (done >= total * (cuts + 1) / stages || rounds - round - 1 == cuts_left))
+                    stage_begin.push_back(round + 1);
+            }
+            stage_begin.push_back(rounds);
+        }
+
+        // Cells written per round for a message of this length, as the encoder sizes them
+        vector<double> encodeCosts(int length) const
+        {
+            vector<double> costs;
+            for (int round = 0; round < rounds; round++)
+            {
+                int size = gridSizeFor(length);
+                length = filler == FULL_GRID ? size * size : RoundMap::compactLength(size, filler);
+                costs.push_back(length);
+            }
+            return costs;
+        }
+
+        vector<int> decodeSizes(int length) const
+        {
+            return filler == FULL_GRID ? RoundMap::decodeGridSizes(length, rounds) : RoundMap::compactDecodeGridSizes(length, rounds, filler);
+        }
+
+        // Per-round cost summed over the whole batch, so one odd message does not skew the
+        // stages. Each distinct length is costed once and weighted by how often it occurs.
+        template <typename Costs>
+        vector<double> batchCosts(const vector<string> &texts, Costs costsFor) const
+        {
+            map<int, size_t> lengths;
+            for (const string &text : texts)
+                lengths[static_cast<int>(text.size())]++;
+
+            vector<double> total(rounds, 0.0);
+            for (const auto &length : lengths)
+            {
+                vector<double> costs = costsFor(length.first);
+                for (int round = 0; round < rounds; round++)
+                    total[round] += costs[round] * length.second;
+            }
+            return total;
+        }
+
+        void encodeRound(Job &job, int round)
+        {
+            if (seeded)
+                seedFiller(seed, job.index * rounds + round);
+            diamond::encode(job.text, 1, job.spare, alphabet, filler);
+            job.text.swap(job.spare);
+        }
+
+        // Each round keeps exactly the characters the previous encoding round produced
+        void decodeRound(Job &job, int round, bool stopAtDot)
+        {
+            diamond::decode(job.text, 1, job.spare, false, filler);
+            if (round + 1 < rounds)
+            {
+                int next = job.sizes[round + 1];
+                job.spare.resize(filler == FULL_GRID ? next * next : RoundMap::compactLength(next, filler));
+            }
+            else
+                job.spare.resize(keptLength(job.spare.data(), job.spare.size(), stopAtDot));
+            job.text.swap(job.spare);
+        }
+
+        // Source thread, one thread per stage, and the calling thread as the sink
+        template <typename Prepare, typename Round>
+        void run(size_t count, Prepare prepare, Round round, vector<string> &results)
+        {
+            guard.reset();
+            results.resize(count);
+            int stages = static_cast<int>(stage_begin.size()) - 1;
+            vector<unique_ptr<BoundedQueue<Job>>> queues;
+            for (int stage = 0; stage <= stages; stage++)
+                queues.emplace_back(new BoundedQueue<Job>(queue_capacity));
+
+            thread source([&]
+                          { guard.run([&]
+                                      {
+                                          for (size_t i = 0; i < count; i++)
+                                          {
+                                              Job job;
+                                              job.index = i;
+                                              prepare(job);
+                                              if (!guard.push(*queues[0], job))
+                                                  return;
+                                          }
+                                          Job stop;
+                                          guard.push(*queues[0], stop); }); });
+
+            vector<thread> workers;
+            for (int stage = 0; stage < stages; stage++)
+                workers.emplace_back([&, stage]
+                                     { guard.run([&]
+                                                 {
+                                                     Job job;
+                                                     while (guard.pop(*queues[stage], job))
+                                                     {
+                                                         if (job.index != STOP)
+                                                             for (int r = stage_begin[stage]; r < stage_begin[stage + 1]; r++)
+                                                                 round(job, r);
+                                                         bool stop = job.index == STOP;
+                                                         if (!guard.push(*queues[stage + 1], job) || stop)
+                                                             return;
+                                                     } }); });
+
+            // Sink: results land at their index, so no reordering is needed
+            guard.run([&]
+                      {
+                          Job job;
+                          for (size_t received = 0; received < count && guard.pop(*queues[stages], job); received++)
+                              results[job.index] = move(job.text); });
+
+            source.join();
+            for (thread &worker : workers)
+                worker.join();
+            guard.rethrow();
+        }
+
+    public:
+        // threads caps the number of stages; there are never more stages than rounds
+        RoundPipeline(int roundCount, int threads)
+            : rounds(roundCount), stage_limit(max(threads, 1)), queue_capacity(4)
+        {
+            if (rounds < 1)
+                throw CustomException("Round number must be greater than 0", true);
+        }
+
+        // Filler depends only on the seed, the message number and the round
+        void setSeed(uint64_t value)
+        {
+            seeded = true;
+            seed = value;
+        }
+
+        void setAlphabet(Alphabet value) { alphabet = value; }
+        void setFiller(int value) { filler = value; }
+
+        // Encrypt every message; results[i] is the ciphertext of messages[i]
+        void encode(const vector<string> &messages, vector<string> &results)
+        {
+            if (messages.empty())
+            {
+                results.clear();
+                return;
+            }
+            planStages(batchCosts(messages, [&](int length)
+                                  { return encodeCosts(length); }));
+
+            run(messages.size(), [&](Job &job)
+                { job.text.assign(messages[job.index]); },
+                [&](Job &job, int round)
+                { encodeRound(job, round); },
+                results);
+        }
+
+        // Decrypt every ciphertext, stopping after the first '.' unless told otherwise
+        void decode(const vector<string> &ciphers, bool stopAtDot, vector<string> &results)
+        {
+            if (ciphers.empty())
+            {
+                results.clear();
+                return;
+            }
+            planStages(batchCosts(ciphers, [&](int length)
+                                  {
+                                      vector<double> costs;
+                                      for (int size : decodeSizes(length))
+                                          costs.push_back(static_cast<double>(size) * size);
+                                      return costs; }));
+
+            run(ciphers.size(), [&](Job &job)
+                {
+                    job.text.assign(ciphers[job.index]);
+                    job.sizes = decodeSizes(static_cast<int>(job.text.size())); },
+                [&](Job &job, int round)
+                { decodeRound(job, round, stopAtDot); },
+                results);
+        }
+
+        // Stages of the last run and the rounds each one handled
+        int getStageCount() const { return static_cast<int>(stage_begin.size()) - 1; }
+        const vector<int> &getStageBegin() const { return stage_begin; }
+    };
+}
+
+#endif // ROUND_PIPELINE_HPP
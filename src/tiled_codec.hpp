@@ -0,0 +1,207 @@
+#ifndef TILED_CODEC_HPP
+#define TILED_CODEC_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include "custom_exception.hpp"
+#include "diamond_codec.hpp"
+
+using namespace std;
+
+// Table-free codec for grids far beyond RoundMap::MAX_GRID_SIZE.
+// A diamond walk goes down and up columns, so on a row-major grid of thousands of
+// rows every step lands on a new cache line, and a per-size index table would be
+// as large as the grid itself. Here the grid is visited in square tiles instead:
+// within a tile the cells are read row by row, and the diamond indices they map to
+// form one short run per ring, so both sides of the copy stay in L1 (the same
+// blocking a cache-friendly transpose uses). Indices come from the closed form of
+// DiamondTable's walk, so no table is built.
+namespace diamond
+{
+    // Largest grid of the tiled path; every diamond index still fits in an int
+    constexpr int MAX_TILED_GRID_SIZE = 32767;
+
+    // Tile edge in cells: a tile and the TILE rings it touches are 2 * TILE cache lines
+    constexpr int TILED_TILE = 64;
+
+    // Rows per band when a round is split into independent pieces (whole tiles only)
+    constexpr int TILED_BAND_ROWS = 4 * TILED_TILE;
+
+    // Runs body(band) for band in [0, count) and returns when all are done.
+    // Bands of one round touch disjoint cells, so they may run in any order or in parallel.
+    using BandRunner = function<void(size_t, const function<void(size_t)> &)>;
+
+    // Number of bands of a grid
+    inline size_t bandCount(int size) { return (size + TILED_BAND_ROWS - 1) / TILED_BAND_ROWS; }
+
+    // Visit every diamond cell of rows [first, last) as visit(row-major cell, diamond index),
+    // one tile at a time. Ring r covers the cells with r = col - |row - tip| left of the tip
+    // column and r = size - 1 - col - |row - tip| right of it (see diamondCell for the ring layout).
+    template <typename Visit>
+    inline void forEachDiamondCellTiled(int size, Visit visit, int first = 0, int last = -1)
+    {
+        int tip = size / 2;
+        if (last < 0)
+            last = size;
+        for (int top = first; top < last; top += TILED_TILE)
+        {
+            int bottom = min(top + TILED_TILE, last);
+            for (int left = 0; left < size; left += TILED_TILE)
+            {
+                int right = min(left + TILED_TILE, size) - 1;
+                for (int row = top; row < bottom; row++)
+                {
+                    int distance = abs(row - tip);
+                    size_t base = static_cast<size_t>(row) * size;
+
+                    // Stepping one column moves one ring in or out; the index step shrinks by 4 each time
+                    int col = max(left, distance), end = min(right, tip);
+                    if (col <= end)
+                    {
+                        int ring = col - distance;
+                        int k = 2 * ring * (size - ring) + row - ring;
+                        for (int step = 2 * size - 4 * ring - 3; col <= end; col++, k += step, step -= 4)
+                            visit(base + col, k);
+                    }
+
+                    col = max(left, tip + 1), end = min(right, size - 1 - distance);
+                    if (col <= end)
+                    {
+                        int ring = size - 1 - col - distance;
+                        int k = 2 * ring * (size - ring) + 2 * size - 2 - 3 * ring - row;
+                        for (int step = 4 * ring - 2 * size + 1; col <= end; col++, k += step, step -= 4)
+                            visit(base + col, k);
+                    }
+                }
+            }
+        }
+    }
+
+    // One round, rows [first, last) only: place the message into the diamond of a row-major
+    // size * size grid. Only the message cells are written; the caller fills the rest.
+    inline void tiledScatter(string_view msg, int size, char *cells, int first = 0, int last = -1)
+    {
+        if (size < 1 || size > MAX_TILED_GRID_SIZE || static_cast<long long>(msg.size()) > static_cast<long long>(size) * size / 2 + 1)
+            throw CustomException(size);
+
+        const char *source = msg.data();
+        int length = static_cast<int>(msg.size());
+        forEachDiamondCellTiled(size, [&](size_t cell, int k)
+                                {
+                                    if (k < length)
+                                        cells[cell] = source[k]; },
+                                first, last);
+    }
+
+    // One round, rows [first, last) only, into a caller buffer of size * size / 2 + 1 characters
+    inline void tiledGather(const char *cells, int size, char *out, int first = 0, int last = -1)
+    {
+        if (size < 1 || size > MAX_TILED_GRID_SIZE)
+            throw CustomException(size);
+
+        forEachDiamondCellTiled(size, [&](size_t cell, int k)
+                                { out[k] = cells[cell]; },
+                                first, last);
+    }
+
+    inline void runBandsInOrder(size_t count, const function<void(size_t)> &body)
+    {
+        for (size_t band = 0; band < count; band++)
+            body(band);
+    }
+
+    // Full-grid encodings that outgrow RoundMap::MAX_GRID_SIZE and need the tiled path
+    inline bool needsTiledEncode(int length, int rounds)
+    {
+        for (int round = 0; round < rounds; round++)
+        {
+            int size = RoundMap::encodeGridSize(length, MAX_TILED_GRID_SIZE);
+            if (size > RoundMap::MAX_GRID_SIZE)
+                return true;
+            length = size * size;
+        }
+        return false;
+    }
+
+    inline bool needsTiledDecode(size_t length) { return length >= static_cast<size_t>(RoundMap::MAX_GRID_SIZE + 2) * (RoundMap::MAX_GRID_SIZE + 2); }
+
+    // Same rounds and format as encode(), for grids up to MAX_TILED_GRID_SIZE.
+    // Each round is cut into row bands that fill and scatter their own rows; runBands
+    // decides where they run.
+    inline string encodeTiled(string_view msg, int rounds, Alphabet alphabet = Alphabet::Letters, const BandRunner &runBands = runBandsInOrder)
+    {
+        if (rounds < 1)
+            throw CustomException("Round number must be greater than 0", true);
+
+        MetricsTimer timer(Metrics::Encode, rounds);
+        string current(msg), next;
+        for (int round = 0; round < rounds; round++)
+        {
+            int size = RoundMap::encodeGridSize(static_cast<int>(current.size()), MAX_TILED_GRID_SIZE);
+            size_t cells = static_cast<size_t>(size) * size;
+            next.resize(cells);
+            runBands(bandCount(size), [&](size_t band)
+                     {
+                         int first = static_cast<int>(band) * TILED_BAND_ROWS;
+                         int last = min(first + TILED_BAND_ROWS, size);
+                         char *rows = &next[0] + static_cast<size_t>(first) * size;
+                         size_t count = static_cast<size_t>(last - first) * size;
+                         if (alphabet == Alphabet::Bytes)
+                             FillerRng::local().fillBytes(rows, count);
+                         else
+                             FillerRng::local().fillLetters(rows, count);
+                         tiledScatter(current, size, &next[0], first, last); });
+
+            if (Metrics::enabled())
+            {
+                Metrics::add(Metrics::OutputCells, cells);
+                Metrics::add(Metrics::FillerCells, cells - current.size());
+                Metrics::gridSize(size);
+            }
+            current.swap(next);
+        }
+
+        if (Metrics::enabled())
+        {
+            Metrics::add(Metrics::EncodeCalls);
+            Metrics::add(Metrics::BytesIn, msg.size());
+            Metrics::add(Metrics::BytesOut, current.size());
+        }
+        return current;
+    }
+
+    // Same rounds and format as decode(), for grids up to MAX_TILED_GRID_SIZE, in row bands like encodeTiled()
+    inline string decodeTiled(string_view cipher, int rounds, bool stopAtDot = true, const BandRunner &runBands = runBandsInOrder)
+    {
+        if (rounds < 1)
+            throw CustomException("Round number must be greater than 0", true);
+
+        if (cipher.size() > static_cast<size_t>(MAX_TILED_GRID_SIZE) * MAX_TILED_GRID_SIZE)
+            throw CustomException("Ciphertext too long for the maximum grid size", true);
+
+        MetricsTimer timer(Metrics::Decode, rounds);
+        vector<int> sizes = RoundMap::decodeGridSizes(static_cast<int>(cipher.size()), rounds);
+        string current, next;
+        const char *cells = cipher.data();
+        for (int size : sizes)
+        {
+            next.resize(static_cast<size_t>(size) * size / 2 + 1);
+            runBands(bandCount(size), [&](size_t band)
+                     {
+                         int first = static_cast<int>(band) * TILED_BAND_ROWS;
+                         tiledGather(cells, size, &next[0], first, min(first + TILED_BAND_ROWS, size)); });
+            current.swap(next);
+            cells = current.data();
+        }
+
+        current.resize(keptLength(current.data(), current.size(), stopAtDot));
+        recordDecode(cipher.size(), current.size());
+        return current;
+    }
+}
+
+#endif // TILED_CODEC_HPP
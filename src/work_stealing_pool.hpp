@@ -0,0 +1,282 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Fixed set of worker threads, each with its own task deque.
+// A worker runs its newest task first (LIFO, still warm in cache); an idle worker steals
+// the oldest task of another worker (FIFO, usually the largest piece left). A task can
+// split itself with forkJoin(): the pieces go on its worker's deque where idle workers
+// can steal them, and the waiting task helps run pieces instead of blocking.
+class WorkStealingPool
+{
+public:
+    // Totals since the pool was created
+    struct Stats
+    {
+        uint64_t tasks = 0;   // tasks run
+        uint64_t steals = 0;  // of which taken from another worker's deque
+        uint64_t busy_ns = 0; // time workers spent running tasks
+        uint64_t wall_ns = 0; // time the pool spent on batches, times the number of workers
+
+        double utilization() const { return wall_ns == 0 ? 0.0 : static_cast<double>(busy_ns) / wall_ns; }
+    };
+
+private:
+    using Task = function<void()>;
+
+    struct Worker
+    {
+        mutex lock;
+        deque<Task> tasks;
+        atomic<uint64_t> executed{0};
+        atomic<uint64_t> stolen{0};
+        atomic<uint64_t> busy{0};
+    };
+
+    // Completion of one forkJoin call; left only changes under lock
+    struct Join
+    {
+        atomic<size_t> left;
+        mutex lock;
+        condition_variable done;
+        exception_ptr error;
+
+        explicit Join(size_t count) : left(count) {}
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    atomic<size_t> queued{0}; // tasks sitting in any deque
+    atomic<size_t> next_queue{0};
+    atomic<uint64_t> wall{0};
+    mutex idle_mutex;
+    condition_variable work_ready;
+    bool stopping = false;
+
+    // Which worker of which pool this thread is; -1 outside the pool
+    static pair<const WorkStealingPool *, int> &current()
+    {
+        thread_local pair<const WorkStealingPool *, int> self(nullptr, -1);
+        return self;
+    }
+
+    int self() const { return current().first == this ? current().second : -1; }
+
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void push(int queue, Task task)
+    {
+        {
+            lock_guard<mutex> lock(workers[queue]->lock);
+            workers[queue]->tasks.push_back(move(task));
+        }
+        queued++;
+        {
+            lock_guard<mutex> lock(idle_mutex); // pairs with the wait in workerLoop, so no wakeup is lost
+        }
+        work_ready.notify_one();
+    }
+
+    // Own deque from the back, then the other deques from the front
+    bool take(int index, Task &task)
+    {
+        if (queued.load() == 0)
+            return false;
+
+        int count = static_cast<int>(workers.size());
+        int start = index < 0 ? 0 : index;
+        for (int i = 0; i < count; i++)
+        {
+            int victim = (start + i) % count;
+            Worker &worker = *workers[victim];
+            lock_guard<mutex> lock(worker.lock);
+            if (worker.tasks.empty())
+                continue;
+
+            if (victim == index)
+            {
+                task = move(worker.tasks.back());
+                worker.tasks.pop_back();
+            }
+            else
+            {
+                task = move(worker.tasks.front());
+                worker.tasks.pop_front();
+                if (index >= 0)
+                    workers[index]->stolen++;
+            }
+            queued--;
+            if (index >= 0)
+                workers[index]->executed++;
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(int index)
+    {
+        current() = make_pair(this, index);
+        while (true)
+        {
+            Task task;
+            if (take(index, task))
+            {
+                uint64_t start = now();
+                task();
+                workers[index]->busy += now() - start;
+                continue;
+            }
+
+            unique_lock<mutex> lock(idle_mutex);
+            work_ready.wait(lock, [this]
+                            { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0)
+                return;
+        }
+    }
+
+    // Count one piece done. The Join is only touched under its lock, so the waiter cannot
+    // see it finished and destroy it while this is still notifying.
+    void finish(Join &join)
+    {
+        {
+            lock_guard<mutex> lock(join.lock);
+            if (--join.left != 0)
+                return;
+            join.done.notify_all();
+        }
+        // Workers joining from inside a task sleep on work_ready
+        {
+            lock_guard<mutex> lock(idle_mutex);
+        }
+        work_ready.notify_all();
+    }
+
+public:
+    explicit WorkStealingPool(int count)
+    {
+        count = max(count, 1);
+        for (int i = 0; i < count; i++)
+            workers.emplace_back(new Worker());
+        for (int i = 0; i < count; i++)
+            threads.emplace_back([this, i]
+                                 { workerLoop(i); });
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            lock_guard<mutex> lock(idle_mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (thread &worker : threads)
+            worker.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Run body(i) for every i in [0, count) as separate stealable tasks and wait; the first
+    // exception is rethrown once every task has finished. From outside the pool the tasks are
+    // dealt round-robin over the deques; from inside a task they go on this worker's deque
+    // and the caller keeps running tasks until its pieces are done.
+    void forkJoin(size_t count, const function<void(size_t)> &body)
+    {
+        if (count == 0)
+            return;
+
+        Join join(count);
+        auto piece = [this, &join, &body](size_t i)
+        {
+            try
+            {
+                body(i);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(join.lock);
+                if (!join.error)
+                    join.error = current_exception();
+            }
+            finish(join);
+        };
+
+        int index = self();
+        if (index < 0)
+        {
+            uint64_t start = now();
+            size_t first = next_queue.fetch_add(count);
+            for (size_t i = 0; i < count; i++)
+                push(static_cast<int>((first + i) % workers.size()), [piece, i]
+                     { piece(i); });
+
+            unique_lock<mutex> lock(join.lock);
+            join.done.wait(lock, [&join]
+                           { return join.left.load() == 0; });
+            wall += (now() - start) * workers.size();
+        }
+        else
+        {
+            // Newest first, so this worker starts on piece 1 while thieves take the far end
+            for (size_t i = count; i-- > 1;)
+                push(index, [piece, i]
+                     { piece(i); });
+            piece(0);
+
+            while (join.left.load() != 0)
+            {
+                Task task;
+                if (take(index, task))
+                {
+                    task();
+                    continue;
+                }
+
+                // Pieces still running elsewhere: sleep until one finishes or new work arrives
+                unique_lock<mutex> lock(idle_mutex);
+                work_ready.wait(lock, [this, &join]
+                                { return queued.load() > 0 || join.left.load() == 0; });
+            }
+        }
+
+        // Waits for the last finish() to leave the lock before the Join goes away
+        lock_guard<mutex> lock(join.lock);
+        if (join.error)
+            rethrow_exception(join.error);
+    }
+
+    Stats getStats() const
+    {
+        Stats stats;
+        for (const unique_ptr<Worker> &worker : workers)
+        {
+            stats.tasks += worker->executed.load();
+            stats.steals += worker->stolen.load();
+            stats.busy_ns += worker->busy.load();
+        }
+        stats.wall_ns = wall.load();
+        return stats;
+    }
+
+    int getWorkerCount() const { return static_cast<int>(workers.size()); }
+};
+
+#endif // WORK_STEALING_POOL_HPP
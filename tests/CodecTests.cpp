@@ -0,0 +1,541 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "diamond_codec.hpp"
+#include "framed_codec.hpp"
+#include "tiled_codec.hpp"
+#include "codec_daemon.hpp"
+#include <thread>
+#include "block_pipeline.hpp"
+#include "round_pipeline.hpp"
+#include "work_stealing_pool.hpp"
+#include "batch_codec.hpp"
+
+class CodecTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        diamond::seedFiller(1); // Fixed filler for repeatable runs
+    }
+};
+
+TEST_F(CodecTest, TestSingleRoundLayout) {
+    // "HELLO" fills the whole diamond of a 3x3 grid
+    string cipher = diamond::encode("HELLO", 1);
+
+    ASSERT_EQ(cipher.length(), 9u);
+    EXPECT_EQ(cipher[1], 'H'); // Tip of the diamond
+    EXPECT_EQ(cipher[3], 'E');
+    EXPECT_EQ(cipher[7], 'L');
+    EXPECT_EQ(cipher[5], 'L');
+    EXPECT_EQ(cipher[4], 'O'); // Centre
+}
+
+TEST_F(CodecTest, TestRoundTripSingleRound) {
+    string cipher = diamond::encode("HELLOWORLD.", 1);
+    EXPECT_EQ(diamond::decode(cipher, 1), "HELLOWORLD.");
+}
+
+TEST_F(CodecTest, TestRoundTripMultiRound) {
+    for (int rounds = 1; rounds <= 4; rounds++) {
+        string cipher = diamond::encode("THEQUICKBROWNFOX.", rounds);
+        EXPECT_EQ(diamond::decode(cipher, rounds), "THEQUICKBROWNFOX.") << "rounds = " << rounds;
+    }
+}
+
+TEST_F(CodecTest, TestGridSizeSelection) {
+    EXPECT_EQ(diamond::gridSizeFor(1), 3);
+    EXPECT_EQ(diamond::gridSizeFor(5), 3);
+    EXPECT_EQ(diamond::gridSizeFor(6), 5);
+    EXPECT_EQ(diamond::decodeGridSize(25), 5);
+    EXPECT_EQ(diamond::decodeGridSize(16), 3); // Even roots round down to odd
+}
+
+TEST_F(CodecTest, TestMessageTooLong) {
+    string longMessage(5000, 'A');
+    EXPECT_THROW(diamond::encode(longMessage, 1), CustomException);
+}
+
+TEST_F(CodecTest, TestNormalize) {
+    EXPECT_EQ(diamond::normalize("hello world"), "HELLOWORLD");
+    EXPECT_THROW(diamond::normalize("1234@"), CustomException);
+    EXPECT_THROW(diamond::normalize(""), CustomException);
+}
+
+TEST_F(CodecTest, TestInvalidRoundNumber) {
+    EXPECT_THROW(diamond::encode("HELLO", 0), CustomException);
+}
+
+TEST_F(CodecTest, TestStreamRoundTripAcrossBlocks) {
+    diamond::StreamOptions options;
+    options.block_size = 4;
+    options.rounds = 2;
+
+    // Longer than one block, with a full stop inside the payload
+    istringstream plain("the quick. brown fox\njumps");
+    ostringstream cipher;
+    diamond::BlockPipeline(options).encode(plain, cipher);
+
+    istringstream cipherIn(cipher.str());
+    ostringstream decoded;
+    diamond::BlockPipeline(options).decode(cipherIn, decoded);
+
+    EXPECT_EQ(decoded.str(), "THEQUICK.BROWNFOXJUMPS");
+}
+
+TEST_F(CodecTest, TestBinaryStreamRoundTrip) {
+    diamond::StreamOptions options;
+    options.block_size = 16;
+    options.rounds = 2;
+    options.binary = true;
+
+    // Every byte value, including whitespace, '.' and NUL
+    string bytes;
+    for (int i = 0; i < 3 * 256; i++)
+        bytes += static_cast<char>(i % 256);
+
+    istringstream plain(bytes);
+    ostringstream cipher;
+    diamond::BlockPipeline(options).encode(plain, cipher);
+
+    istringstream cipherIn(cipher.str());
+    ostringstream decoded;
+    diamond::BlockPipeline(options).decode(cipherIn, decoded);
+
+    EXPECT_EQ(decoded.str(), bytes);
+    EXPECT_EQ(diamond::unframe(diamond::frame(bytes.substr(0, 200), 1, diamond::Alphabet::Bytes)), bytes.substr(0, 200));
+}
+
+TEST_F(CodecTest, TestDaemonRoundTrip) {
+    string path = "/tmp/diamond-codec-test-" + to_string(getpid()) + ".sock";
+    diamond::CodecServer server(path, 2);
+    thread loop([&] { server.run(); });
+
+    {
+        diamond::CodecClient client(path);
+        string cipher = client.encode("MEETATNOON.", 2);
+        EXPECT_EQ(client.decode(cipher, 2), "MEETATNOON.");
+
+        // Pipelined requests come back in order
+        for (int i = 0; i < 50; i++)
+            client.send(diamond::wire::Frame, 1 + i % 3, string(1 + i, 'A' + i % 26));
+        for (int i = 0; i < 50; i++)
+            EXPECT_EQ(diamond::unframe(client.receive()), string(1 + i, 'A' + i % 26));
+
+        EXPECT_THROW(client.encode("HELLO", 0), CustomException);
+        EXPECT_EQ(client.decode(cipher, 2), "MEETATNOON."); // connection survives a failed request
+
+        // Letters are normalized like CLI input; binary payloads are decoded through frames only
+        EXPECT_EQ(client.decode(client.encode("meet at noon.", 1), 1), "MEETATNOON.");
+        EXPECT_THROW(client.encode("HELLO!", 1), CustomException);
+        string bytes("A.\0\xff.", 5);
+        EXPECT_THROW(client.decode(client.encode(bytes, 1, diamond::Alphabet::Bytes), 1, diamond::Alphabet::Bytes), CustomException);
+        EXPECT_EQ(client.call(diamond::wire::Unframe, 0, client.call(diamond::wire::Frame, 1, bytes, diamond::Alphabet::Bytes), diamond::Alphabet::Bytes), bytes);
+    }
+
+    server.stop();
+    loop.join();
+    EXPECT_EQ(server.getServedCount(), 61u);
+}
+
+TEST_F(CodecTest, TestBlockPipelineAcrossThreads) {
+    diamond::StreamOptions options;
+    options.block_size = 7;
+    options.rounds = 2;
+    options.threads = 3;
+    options.seeded = true;
+    options.seed = 11;
+
+    string text;
+    for (int i = 0; i < 1000; i++)
+        text += static_cast<char>('A' + i % 26);
+
+    // Seeded output does not depend on the number of workers
+    diamond::StreamOptions single = options;
+    single.threads = 1;
+    istringstream plainA(text), plainB(text);
+    ostringstream streamed, piped;
+    diamond::BlockPipeline(single).encode(plainA, streamed);
+    diamond::BlockPipeline(options).encode(plainB, piped);
+    EXPECT_EQ(piped.str(), streamed.str());
+
+    // Full blocks decode on their own
+    size_t cipher_block = diamond::encodedLength(options.block_size, options.rounds);
+    EXPECT_EQ(diamond::decode(piped.str().substr(0, cipher_block), options.rounds, false).substr(0, 7), text.substr(0, 7));
+
+    istringstream cipherIn(piped.str());
+    ostringstream decoded;
+    diamond::BlockPipeline(options).decode(cipherIn, decoded);
+    EXPECT_EQ(decoded.str(), text);
+
+    // A bad character fails the whole pipeline instead of hanging it
+    istringstream bad(text + "1" + text);
+    ostringstream ignored;
+    EXPECT_THROW(diamond::BlockPipeline(options).encode(bad, ignored), CustomException);
+}
+
+TEST_F(CodecTest, TestMetricsAcrossThreads) {
+    diamond::Metrics::Snapshot before = diamond::Metrics::snapshot();
+    diamond::Metrics::enable();
+
+    string cipher = diamond::encode("HELP.", 1); // 3x3 grid, 4 filler cells
+    thread worker([&] { diamond::decode(cipher, 1); }); // folded in when the thread exits
+    worker.join();
+
+    diamond::Metrics::enable(false);
+    diamond::encode("HELLO.", 1); // not recorded
+
+    diamond::Metrics::Snapshot after = diamond::Metrics::snapshot();
+    EXPECT_EQ(after.counters[diamond::Metrics::EncodeCalls] - before.counters[diamond::Metrics::EncodeCalls], 1u);
+    EXPECT_EQ(after.counters[diamond::Metrics::DecodeCalls] - before.counters[diamond::Metrics::DecodeCalls], 1u);
+    EXPECT_EQ(after.counters[diamond::Metrics::OutputCells] - before.counters[diamond::Metrics::OutputCells], 9u);
+    EXPECT_EQ(after.counters[diamond::Metrics::FillerCells] - before.counters[diamond::Metrics::FillerCells], 4u);
+    EXPECT_EQ(after.grid_sizes[3] - before.grid_sizes[3], 1u);
+    EXPECT_EQ(after.latency[diamond::Metrics::Encode][1].count - before.latency[diamond::Metrics::Encode][1].count, 1u);
+
+    EXPECT_NE(diamond::Metrics::toJson().find("\"encode_calls\":"), string::npos);
+
+    // Every exported histogram carries the whole bucket ladder plus +Inf
+    string prometheus = diamond::Metrics::toPrometheus();
+    size_t buckets = 0;
+    for (size_t pos = prometheus.find("diamond_encode_seconds_bucket{rounds=\"1\""); pos != string::npos; pos = prometheus.find("diamond_encode_seconds_bucket{rounds=\"1\"", pos + 1))
+        buckets++;
+    EXPECT_EQ(buckets, static_cast<size_t>(diamond::Metrics::LATENCY_BUCKETS + 1));
+}
+
+TEST_F(CodecTest, TestKernelsMatchScalar) {
+    // Every kernel this CPU supports must agree with the scalar loop
+    for (int size = 3; size <= 41; size += 2) {
+        const DiamondTable &table = DiamondTable::forSize(size);
+        string cipher(size * size, ' ');
+        for (size_t i = 0; i < cipher.length(); i++)
+            cipher[i] = 'A' + rand() % 26;
+
+        string expected(table.getDiamondSize(), ' ');
+        table.getDecodePlan().apply(cipher.data(), &expected[0], diamond::Kernel::Scalar);
+
+        for (diamond::Kernel kernel : {diamond::Kernel::Permute, diamond::Kernel::Shuffle, diamond::Kernel::Gather}) {
+            string actual(table.getDiamondSize(), ' ');
+            table.getDecodePlan().apply(cipher.data(), &actual[0], kernel);
+            EXPECT_EQ(actual, expected) << "size = " << size;
+        }
+    }
+}
+
+TEST_F(CodecTest, TestFixedCodecMatchesTable) {
+    // Compile-time tables must match the runtime walk for every specialized size
+    for (int size = 3; size <= diamond::MAX_FIXED_SIZE; size += 2) {
+        const DiamondTable &table = DiamondTable::forSize(size);
+        string msg(table.getDiamondSize() - 1, ' ');
+        for (char &c : msg)
+            c = 'A' + rand() % 26;
+
+        string fixed(size * size, '?');
+        diamond::fixedScatter(msg, size, &fixed[0]);
+        string expected(size * size, ' ');
+        for (size_t k = 0; k < msg.length(); k++)
+            expected[table[k]] = msg[k];
+        EXPECT_EQ(fixed, expected) << "size = " << size;
+
+        string out(table.getDiamondSize(), ' ');
+        diamond::fixedGather(fixed.data(), size, &out[0]);
+        EXPECT_EQ(out, msg + ' ') << "size = " << size;
+    }
+}
+
+TEST_F(CodecTest, TestCallerBuffers) {
+    string msg = "MEETATNOON.";
+    char cipher[256];
+    char plain[256];
+
+    size_t length = diamond::encodeInto(msg, 2, cipher, sizeof(cipher));
+    EXPECT_EQ(length, static_cast<size_t>(diamond::encodedLength(static_cast<int>(msg.length()), 2)));
+
+    size_t kept = diamond::decodeInto(string_view(cipher, length), 2, plain, sizeof(plain), true);
+    EXPECT_EQ(string(plain, kept), msg);
+
+    EXPECT_THROW(diamond::encodeInto(msg, 2, cipher, length - 1), CustomException);
+    EXPECT_THROW(diamond::decodeInto(string_view(cipher, length), 2, plain, 1, true), CustomException);
+}
+
+TEST_F(CodecTest, TestDiamondCellMatchesTable) {
+    for (int size = 1; size <= 99; size += 2) {
+        const DiamondTable &table = DiamondTable::forSize(size);
+        for (int k = 0; k < table.getDiamondSize(); k++)
+            ASSERT_EQ(diamond::diamondCell(size, k), table[k]) << "size = " << size << ", k = " << k;
+    }
+}
+
+TEST_F(CodecTest, TestDecodeRange) {
+    string msg = "THEQUICKBROWNFOXJUMPSOVERTHELAZYDOG.";
+    for (int rounds = 1; rounds <= 3; rounds++) {
+        string cipher = diamond::encode(msg, rounds);
+        string full = diamond::decode(cipher, rounds, false);
+
+        EXPECT_EQ(diamond::decodeRange(cipher, rounds, 0, 9), "THEQUICKB");
+        EXPECT_EQ(diamond::decodeRange(cipher, rounds, 13, 16), "FOX");
+        EXPECT_EQ(diamond::decodeRange(cipher, rounds, 0, full.length()), full);
+        EXPECT_THROW(diamond::decodeRange(cipher, rounds, 0, full.length() + 1), CustomException);
+    }
+
+    // No rounds leaves no grid size to walk back through
+    string cipher = diamond::encode("HELLO.", 1);
+    EXPECT_THROW(diamond::decodeRange(cipher, 0, 0, 3), CustomException);
+    EXPECT_THROW(diamond::decodeRange(cipher, -1, 0, 3), CustomException);
+}
+
+TEST_F(CodecTest, TestFramedRoundTrip) {
+    // Full stops are ordinary payload characters in a frame
+    for (string msg : {"A", "DR.NO.MEETS.AT.NOON", "...", "LONGERMESSAGEWITHNOSTOPATALL"}) {
+        for (int rounds = 1; rounds <= 3; rounds++) {
+            string framed = diamond::frame(msg, rounds);
+            EXPECT_EQ(framed.length(), diamond::framedLength(static_cast<int>(msg.length()), rounds));
+            EXPECT_EQ(diamond::unframe(framed), msg);
+        }
+    }
+
+    diamond::FrameHeader header = diamond::parseFrameHeader(diamond::frame("HELLO", 2));
+    EXPECT_EQ(header.length, 5);
+    EXPECT_EQ(header.rounds, 2);
+}
+
+TEST_F(CodecTest, TestMalformedFrame) {
+    string framed = diamond::frame("HELLO", 1);
+    EXPECT_THROW(diamond::unframe("HELLO"), CustomException);
+    EXPECT_THROW(diamond::unframe("5,1"), CustomException);
+    EXPECT_THROW(diamond::unframe("5,0:ABCDEFGHI"), CustomException);
+    EXPECT_THROW(diamond::parseFrameHeader("5,4294967297:ABCDEFGHI"), CustomException);
+    EXPECT_THROW(diamond::parseFrameHeader("4294967301,1:ABCDEFGHI"), CustomException);
+    EXPECT_THROW(diamond::parseFrameHeader("5,65536:ABCDEFGHI"), CustomException);
+    EXPECT_THROW(diamond::unframe(framed.substr(0, framed.length() - 1)), CustomException);
+}
+
+TEST_F(CodecTest, TestCompactRoundTrip) {
+    string msg = "THEQUICKBROWNFOXJUMPSOVERTHELAZYDOG.";
+    for (int filler : {0, 1, 4, 1000}) {
+        for (int rounds = 1; rounds <= 6; rounds++) {
+            string cipher = diamond::encode(msg, rounds, diamond::Alphabet::Letters, filler);
+            EXPECT_EQ(cipher.length(), static_cast<size_t>(diamond::encodedLength(static_cast<int>(msg.length()), rounds, filler)));
+            EXPECT_EQ(diamond::decode(cipher, rounds, true, filler), msg) << "filler = " << filler << ", rounds = " << rounds;
+        }
+    }
+}
+
+TEST_F(CodecTest, TestCompactGrowthIsLinear) {
+    // 36 characters fill the 9x9 diamond (41 cells); without filler later rounds keep that size
+    EXPECT_EQ(diamond::encodedLength(36, 1, 0), 41);
+    EXPECT_EQ(diamond::encodedLength(36, 8, 0), 41);
+
+    // With filler each round moves up one grid size: 41 + 4, then 61 + 4, ...
+    EXPECT_EQ(diamond::encodedLength(36, 1, 4), 45);
+    EXPECT_EQ(diamond::encodedLength(36, 2, 4), 65);
+    EXPECT_EQ(diamond::encodedLength(36, 3, 4), 89);
+
+    string cipher = diamond::encode("HELLO.", 2, diamond::Alphabet::Letters, 3);
+    EXPECT_THROW(diamond::decode(cipher.substr(1), 2, true, 3), CustomException);
+    EXPECT_THROW(diamond::encode("HELLO.", 1, diamond::Alphabet::Letters, -2), CustomException);
+}
+
+TEST_F(CodecTest, TestTiledWalkMatchesTable) {
+    for (int size = 1; size <= 99; size += 2) {
+        const DiamondTable &table = DiamondTable::forSize(size);
+        vector<int> seen(table.getDiamondSize(), -1);
+        diamond::forEachDiamondCellTiled(size, [&](size_t cell, int k) { seen[k] = static_cast<int>(cell); });
+        ASSERT_EQ(seen, table.getCells()) << "size = " << size;
+    }
+
+    // Past the table limit, against the closed form
+    for (int size : {129, 1001}) {
+        int visited = 0;
+        diamond::forEachDiamondCellTiled(size, [&](size_t cell, int k) {
+            visited++;
+            ASSERT_EQ(static_cast<size_t>(diamond::diamondCell(size, k)), cell);
+        });
+        EXPECT_EQ(visited, size * size / 2 + 1);
+    }
+}
+
+TEST_F(CodecTest, TestTiledRoundTrip) {
+    // Interchangeable with the table codec where both apply
+    string msg = "THEQUICKBROWNFOXJUMPSOVERTHELAZYDOG.";
+    for (int rounds = 1; rounds <= 3; rounds++) {
+        EXPECT_EQ(diamond::decode(diamond::encodeTiled(msg, rounds), rounds), msg);
+        EXPECT_EQ(diamond::decodeTiled(diamond::encode(msg, rounds), rounds), msg);
+    }
+
+    // Beyond the 99 limit: a 1415x1415 grid, then 2003x2003
+    string large(1000000, 'A');
+    for (size_t i = 0; i < large.length(); i++)
+        large[i] = static_cast<char>('A' + i * 7 % 26);
+    large.back() = '.';
+    string cipher = diamond::encodeTiled(large, 2);
+    EXPECT_EQ(cipher.length(), 2003u * 2003u);
+    EXPECT_EQ(diamond::decodeTiled(cipher, 2), large);
+}
+
+TEST_F(CodecTest, TestRoundPipelineMatchesCodec) {
+    vector<string> messages;
+    for (int i = 0; i < 40; i++)
+        messages.push_back(string(5 + i * 3, static_cast<char>('A' + i % 26)) + ".");
+
+    for (int filler : {diamond::FULL_GRID, 2}) {
+        for (int threads : {1, 3, 8}) {
+            int rounds = filler == diamond::FULL_GRID ? 3 : 6;
+            diamond::RoundPipeline pipeline(rounds, threads);
+            pipeline.setFiller(filler);
+
+            vector<string> ciphers, plain;
+            pipeline.encode(messages, ciphers);
+            EXPECT_EQ(pipeline.getStageCount(), min(threads, rounds));
+            ASSERT_EQ(ciphers.size(), messages.size());
+            for (size_t i = 0; i < messages.size(); i++) {
+                EXPECT_EQ(ciphers[i].length(), static_cast<size_t>(diamond::encodedLength(static_cast<int>(messages[i].length()), rounds, filler)));
+                EXPECT_EQ(diamond::decode(ciphers[i], rounds, true, filler), messages[i]);
+            }
+
+            pipeline.decode(ciphers, true, plain);
+            EXPECT_EQ(plain, messages) << "threads = " << threads << ", filler = " << filler;
+        }
+    }
+
+    // Stages are planned from the whole batch, not from whichever message comes first
+    {
+        diamond::RoundPipeline pipeline(6, 3);
+        pipeline.setFiller(2);
+        vector<string> reversed(messages.rbegin(), messages.rend()), ciphers;
+        pipeline.encode(messages, ciphers);
+        vector<int> forward = pipeline.getStageBegin();
+        pipeline.encode(reversed, ciphers);
+        EXPECT_EQ(pipeline.getStageBegin(), forward);
+    }
+
+    // A failing message stops the whole batch and surfaces its error
+    diamond::RoundPipeline pipeline(2, 2);
+    vector<string> results;
+    EXPECT_THROW(pipeline.decode({"ABCDEFGHIJKLMNOPQRSTUVWXY", ""}, true, results), CustomException);
+}
+
+TEST_F(CodecTest, TestWorkStealingForkJoin) {
+    WorkStealingPool pool(3);
+    vector<atomic<int>> hits(64);
+    pool.forkJoin(8, [&](size_t outer) {
+        pool.forkJoin(8, [&](size_t inner) { hits[outer * 8 + inner]++; });
+    });
+    for (atomic<int> &hit : hits)
+        EXPECT_EQ(hit.load(), 1);
+
+    // The first piece of a nested join runs inline on its caller
+    WorkStealingPool::Stats stats = pool.getStats();
+    EXPECT_EQ(stats.tasks, 8u + 8u * 7u);
+    EXPECT_GT(stats.wall_ns, 0u);
+
+    EXPECT_THROW(pool.forkJoin(4, [](size_t i) {
+        if (i == 2)
+            throw CustomException("Band failed");
+    }), CustomException);
+}
+
+TEST_F(CodecTest, TestMixedBatchRoundTrip) {
+    // One block far past the table codec's limit among short ones
+    vector<string> blocks;
+    for (int i = 0; i < 30; i++)
+        blocks.push_back(string(10 + i, static_cast<char>('A' + i % 26)) + ".");
+    string large(300000, 'Q');
+    for (size_t i = 0; i < large.length(); i += 7)
+        large[i] = 'Z';
+    large.back() = '.';
+    blocks.insert(blocks.begin() + 3, large);
+
+    diamond::Metrics::enable();
+    diamond::ParallelCodec codec(3);
+    vector<string> ciphers, plain;
+    codec.encodeBlocks(blocks, 2, ciphers);
+    codec.decodeBlocks(ciphers, 2, true, plain);
+    diamond::Metrics::enable(false);
+
+    EXPECT_EQ(plain, blocks);
+    EXPECT_EQ(diamond::decodeTiled(ciphers[3], 2), large);
+
+    // 31 blocks each way, plus the row bands of the large block's rounds
+    WorkStealingPool::Stats stats = codec.getStats();
+    EXPECT_GT(stats.tasks, 62u);
+    EXPECT_GE(diamond::Metrics::snapshot().counters[diamond::Metrics::TasksRun], stats.tasks);
+    EXPECT_GT(stats.utilization(), 0.0);
+    EXPECT_LE(stats.steals, stats.tasks);
+}
+
+TEST_F(CodecTest, TestBatchCodecMatchesCodec) {
+    // Mixed lengths, so buckets hold messages of several lengths and partial chunks
+    vector<string> messages;
+    for (int i = 0; i < 300; i++)
+        messages.push_back(string(i % 150, static_cast<char>('A' + i % 26)) + ".");
+
+    for (int filler : {diamond::FULL_GRID, 2}) {
+        for (int threads : {1, 3}) {
+            diamond::BatchCodec batch(2, threads);
+            batch.setFiller(filler);
+            batch.setSeed(11);
+
+            vector<string> ciphers, again, plain;
+            batch.encode(messages, ciphers);
+            EXPECT_EQ(batch.getBuckets().size(), 9u); // odd grid sizes 3..19
+            ASSERT_EQ(ciphers.size(), messages.size());
+            for (size_t i = 0; i < messages.size(); i++) {
+                EXPECT_EQ(ciphers[i].length(), static_cast<size_t>(diamond::encodedLength(static_cast<int>(messages[i].length()), 2, filler)));
+                EXPECT_EQ(diamond::decode(ciphers[i], 2, true, filler), messages[i]);
+            }
+
+            batch.encode(messages, again);
+            EXPECT_EQ(again, ciphers);
+
+            batch.decode(ciphers, true, plain);
+            EXPECT_EQ(plain, messages) << "threads = " << threads << ", filler = " << filler;
+        }
+    }
+
+    // Byte filler never produces the '.' a decoder stops at
+    diamond::BatchCodec bytes(3);
+    bytes.setAlphabet(diamond::Alphabet::Bytes);
+    vector<string> binary = {string("\x00\xff\x01.", 4), string(70, '\x7f') + "."}, ciphers, plain;
+    bytes.encode(binary, ciphers);
+    bytes.decode(ciphers, true, plain);
+    EXPECT_EQ(plain, binary);
+
+    diamond::BatchCodec batch(1);
+    vector<string> results;
+    EXPECT_THROW(batch.encode({"AB", string(5000, 'A')}, results), CustomException);
+}
+
+TEST_F(CodecTest, TestRoundMapCacheIsBounded) {
+    // Ciphertexts past the largest table grid are refused instead of cached
+    EXPECT_THROW(diamond::decode(string(101 * 101, 'A'), 1), CustomException);
+
+    // Past the cache bound maps are still built, just not kept
+    for (int length = 1; length <= static_cast<int>(RoundMap::MAX_CACHED_MAPS) + 200; length++) {
+        string message(length % 4000 + 1, 'Q');
+        message.back() = '.';
+        ASSERT_EQ(diamond::decode(diamond::encode(message, 1), 1), message);
+        ASSERT_EQ(diamond::decodedLength(length + 8, 1), (diamond::decodeGridSize(length + 8) * diamond::decodeGridSize(length + 8)) / 2 + 1);
+    }
+
+    // Uncached maps stay valid for as long as the caller holds them
+    vector<shared_ptr<const RoundMap>> held;
+    for (int length = 5000; length < 5008; length++)
+        held.push_back(RoundMap::decoding(length, 1));
+    for (int i = 0; i < 8; i++)
+        EXPECT_EQ(held[i]->getOutputLength(), diamond::decodedLength(5000 + i, 1));
+}
+
+TEST_F(CodecTest, TestSeededFillerIsReproducible) {
+    diamond::seedFiller(7);
+    string first = diamond::encode("HELLO", 3);
+    diamond::seedFiller(7);
+    string second = diamond::encode("HELLO", 3);
+
+    EXPECT_EQ(first, second);
+    for (char c : first)
+        EXPECT_TRUE(c >= 'A' && c <= 'Z');
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}